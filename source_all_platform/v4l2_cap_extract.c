@@ -0,0 +1,208 @@
+/**
+ * @file v4l2_cap_extract.c
+ * @brief 容器捕获文件（.v4lcap）的列表与帧提取工具
+ *
+ * 从文件尾部的trailer定位索引，支持O(1)按frame_id提取单帧，
+ * 无需顺序扫描整个容器。
+ *
+ * @author Development Team
+ * @date 2025-06-24
+ * @version 2.0
+ */
+
+#include "v4l2_usb_pc.h"
+
+/**
+ * @brief 打印工具使用说明
+ */
+static void print_extract_usage(const char* prog_name)
+{
+    printf("V4L2 Capture Container Extractor\n");
+    printf("Usage: %s <capture.v4lcap> [frame_id] [output_file]\n", prog_name);
+    printf("\n");
+    printf("  Without frame_id: list all frames in the container index\n");
+    printf("  With frame_id:    extract that frame's payload to output_file\n");
+    printf("                    (default name: frame_<id>_<W>x<H>.<ext>)\n");
+    printf("\nExample:\n");
+    printf("  %s capture.v4lcap              # List frames\n", prog_name);
+    printf("  %s capture.v4lcap 42           # Extract frame 42\n", prog_name);
+    printf("  %s capture.v4lcap 42 out.raw   # Extract to out.raw\n", prog_name);
+}
+
+/**
+ * @brief 读取并校验容器索引
+ *
+ * @param fp 已打开的容器文件
+ * @param trailer 输出：文件尾部结构
+ * @return 索引数组（调用者负责free），失败返回NULL
+ */
+static struct container_index_entry* load_index(FILE* fp,
+                                                struct container_trailer* trailer)
+{
+    struct container_file_header file_header;
+
+    if (fread(&file_header, sizeof(file_header), 1, fp) != 1 ||
+        file_header.magic != CONTAINER_MAGIC) {
+        printf("Error: Not a capture container (bad file magic)\n");
+        return NULL;
+    }
+    if (file_header.version != CONTAINER_VERSION) {
+        printf("Error: Unsupported container version %u\n", file_header.version);
+        return NULL;
+    }
+
+    if (fseek(fp, -(long)sizeof(*trailer), SEEK_END) != 0 ||
+        fread(trailer, sizeof(*trailer), 1, fp) != 1 ||
+        trailer->magic != CONTAINER_INDEX_MAGIC) {
+        printf("Error: Container index not found (truncated capture?)\n");
+        return NULL;
+    }
+
+    if (trailer->entry_count == 0) {
+        printf("Container is empty (0 frames)\n");
+        return NULL;
+    }
+
+    struct container_index_entry* entries = (struct container_index_entry*)
+        malloc(trailer->entry_count * sizeof(*entries));
+    if (!entries) {
+        printf("Error: Failed to allocate index (%u entries)\n",
+               trailer->entry_count);
+        return NULL;
+    }
+
+    if (fseek(fp, (long)trailer->index_offset, SEEK_SET) != 0 ||
+        fread(entries, sizeof(*entries), trailer->entry_count, fp) !=
+            trailer->entry_count) {
+        printf("Error: Failed to read container index\n");
+        free(entries);
+        return NULL;
+    }
+
+    return entries;
+}
+
+/**
+ * @brief 列出容器中的所有帧
+ */
+static void list_frames(const struct container_index_entry* entries,
+                        uint32_t count)
+{
+    printf("%8s  %12s  %12s  %s\n", "frame_id", "offset", "size", "timestamp");
+    for (uint32_t i = 0; i < count; i++) {
+        printf("%8u  %12llu  %12u  %.6fs\n",
+               entries[i].frame_id,
+               (unsigned long long)entries[i].offset,
+               entries[i].size,
+               entries[i].timestamp / 1000000000.0);
+    }
+    printf("Total: %u frames\n", count);
+}
+
+/**
+ * @brief 按frame_id提取单帧负载到文件
+ */
+static int extract_frame(FILE* fp, const struct container_index_entry* entries,
+                         uint32_t count, uint32_t frame_id,
+                         const char* output_file)
+{
+    const struct container_index_entry* entry = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        if (entries[i].frame_id == frame_id) {
+            entry = &entries[i];
+            break;
+        }
+    }
+    if (!entry) {
+        printf("Error: Frame %u not found in container\n", frame_id);
+        return -1;
+    }
+
+    // 直接seek到索引指向的记录，读取帧头和负载
+    struct frame_header header;
+    if (fseek(fp, (long)entry->offset, SEEK_SET) != 0 ||
+        fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != 0xDEADBEEF) {
+        printf("Error: Corrupt frame record at offset %llu\n",
+               (unsigned long long)entry->offset);
+        return -1;
+    }
+
+    uint8_t* data = (uint8_t*)malloc(header.size);
+    if (!data) {
+        printf("Error: Failed to allocate %u bytes\n", header.size);
+        return -1;
+    }
+    if (fread(data, 1, header.size, fp) != header.size) {
+        printf("Error: Truncated frame payload\n");
+        free(data);
+        return -1;
+    }
+
+    // 默认输出文件名与逐帧保存模式保持一致
+    char default_name[MAX_FILENAME_LEN];
+    if (!output_file) {
+        const char* ext = (header.pixfmt == 0x30314742) ? "BG10" : "raw";
+        snprintf(default_name, sizeof(default_name), "frame_%06u_%ux%u.%s",
+                 header.frame_id, header.width, header.height, ext);
+        output_file = default_name;
+    }
+
+    FILE* out = fopen(output_file, "wb");
+    if (!out) {
+        printf("Error: Failed to create %s\n", output_file);
+        free(data);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, header.size, out);
+    fclose(out);
+    free(data);
+
+    if (written != header.size) {
+        printf("Error: Short write to %s\n", output_file);
+        return -1;
+    }
+
+    printf("Extracted frame %u: %ux%u, %u bytes -> %s\n",
+           header.frame_id, header.width, header.height, header.size,
+           output_file);
+    return 0;
+}
+
+/**
+ * @brief 工具入口点
+ */
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4) {
+        print_extract_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* fp = fopen(argv[1], "rb");
+    if (!fp) {
+        printf("Error: Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    struct container_trailer trailer;
+    struct container_index_entry* entries = load_index(fp, &trailer);
+    if (!entries) {
+        fclose(fp);
+        return 1;
+    }
+
+    int ret = 0;
+    if (argc == 2) {
+        list_frames(entries, trailer.entry_count);
+    } else {
+        uint32_t frame_id = (uint32_t)atoi(argv[2]);
+        const char* output_file = (argc == 4) ? argv[3] : NULL;
+        ret = extract_frame(fp, entries, trailer.entry_count, frame_id,
+                            output_file);
+    }
+
+    free(entries);
+    fclose(fp);
+    return (ret == 0) ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file v4l2_lz.c
+ * @brief 帧数据LZ4块格式压缩/解压实现
+ *
+ * @author Development Team
+ * @date 2025-06-25
+ * @version 1.0
+ */
+
+#include "v4l2_lz.h"
+
+#include <string.h>
+
+// ========================== 内部常量 ==========================
+
+/** @brief 哈希表位数，4KB表在RV1103的L1缓存中驻留良好 */
+#define LZ_HASH_BITS 12
+
+/** @brief 哈希表条目数 */
+#define LZ_HASH_SIZE (1u << LZ_HASH_BITS)
+
+/** @brief 最小匹配长度（LZ4块格式规定） */
+#define LZ_MIN_MATCH 4
+
+/** @brief 最大回溯偏移（2字节偏移字段上限） */
+#define LZ_MAX_OFFSET 65535
+
+/** @brief 输入末尾保留的纯字面量区（LZ4块格式结束规则） */
+#define LZ_LAST_LITERALS 12
+
+// ========================== 内部工具函数 ==========================
+
+/** @brief 非对齐读取32位小端值 */
+static inline uint32_t lz_read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** @brief 4字节序列哈希（Fibonacci散列） */
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// ========================== 对外接口 ==========================
+
+size_t lz_compress_bound(size_t size)
+{
+    // LZ4最坏情况：每255字节字面量多1字节长度扩展，再加token开销
+    return size + size / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t* src, size_t src_len,
+                   uint8_t* dst, size_t dst_cap)
+{
+    uint32_t table[LZ_HASH_SIZE];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* ip        = src;
+    const uint8_t* anchor    = src;
+    const uint8_t* src_end   = src + src_len;
+    const uint8_t* match_end =
+        src_len > LZ_LAST_LITERALS ? src_end - LZ_LAST_LITERALS : src;
+    uint8_t* op      = dst;
+    uint8_t* dst_end = dst + dst_cap;
+
+    if (src_len == 0)
+    {
+        return 0;
+    }
+
+    while (ip < match_end)
+    {
+        // 查表找候选匹配
+        uint32_t h         = lz_hash(lz_read32(ip));
+        size_t cand_off    = table[h];
+        const uint8_t* ref = src + cand_off;
+        table[h]           = (uint32_t)(ip - src);
+
+        if (ref >= ip || (size_t)(ip - ref) > LZ_MAX_OFFSET ||
+            lz_read32(ref) != lz_read32(ip))
+        {
+            ip++;
+            continue;
+        }
+
+        // 扩展匹配长度
+        const uint8_t* mp = ref + LZ_MIN_MATCH;
+        const uint8_t* p  = ip + LZ_MIN_MATCH;
+        while (p < match_end && *p == *mp)
+        {
+            p++;
+            mp++;
+        }
+
+        size_t lit_len   = (size_t)(ip - anchor);
+        size_t match_len = (size_t)(p - ip) - LZ_MIN_MATCH;
+        uint16_t offset  = (uint16_t)(ip - ref);
+
+        // 输出空间检查：token + 字面量长度扩展 + 字面量 + 偏移 +
+        // 匹配长度扩展
+        if (op + 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1 >
+            dst_end)
+        {
+            return 0;
+        }
+
+        // token：高4位字面量长度，低4位匹配长度
+        uint8_t* token = op++;
+        *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+
+        if (lit_len >= 15)
+        {
+            size_t rest = lit_len - 15;
+            while (rest >= 255)
+            {
+                *op++ = 255;
+                rest -= 255;
+            }
+            *op++ = (uint8_t)rest;
+        }
+
+        memcpy(op, anchor, lit_len);
+        op += lit_len;
+
+        // 2字节小端偏移
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+
+        *token |= (uint8_t)(match_len >= 15 ? 15 : match_len);
+        if (match_len >= 15)
+        {
+            size_t rest = match_len - 15;
+            while (rest >= 255)
+            {
+                *op++ = 255;
+                rest -= 255;
+            }
+            *op++ = (uint8_t)rest;
+        }
+
+        ip     = p;
+        anchor = p;
+    }
+
+    // 末尾字面量块（无匹配部分）
+    size_t lit_len = (size_t)(src_end - anchor);
+    if (op + 1 + lit_len / 255 + 1 + lit_len > dst_end)
+    {
+        return 0;
+    }
+
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15)
+    {
+        size_t rest = lit_len - 15;
+        while (rest >= 255)
+        {
+            *op++ = 255;
+            rest -= 255;
+        }
+        *op++ = (uint8_t)rest;
+    }
+    memcpy(op, anchor, lit_len);
+    op += lit_len;
+
+    return (size_t)(op - dst);
+}
+
+int lz_decompress(const uint8_t* src, size_t src_len,
+                  uint8_t* dst, size_t dst_cap)
+{
+    const uint8_t* ip      = src;
+    const uint8_t* src_end = src + src_len;
+    uint8_t* op            = dst;
+    uint8_t* dst_end       = dst + dst_cap;
+
+    while (ip < src_end)
+    {
+        uint8_t token = *ip++;
+
+        // 字面量
+        size_t lit_len = token >> 4;
+        if (lit_len == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= src_end)
+                {
+                    return -1;
+                }
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+
+        if (ip + lit_len > src_end || op + lit_len > dst_end)
+        {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // 最后一个块没有匹配部分
+        if (ip >= src_end)
+        {
+            break;
+        }
+
+        // 匹配
+        if (ip + 2 > src_end)
+        {
+            return -1;
+        }
+        uint16_t offset = (uint16_t)(ip[0] | (ip[1] << 8));
+        ip += 2;
+
+        size_t match_len = (token & 0x0F);
+        if (match_len == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= src_end)
+                {
+                    return -1;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+
+        if (offset == 0 || (size_t)(op - dst) < offset ||
+            op + match_len > dst_end)
+        {
+            return -1;
+        }
+
+        // 匹配可能与输出重叠（offset < match_len），必须逐字节拷贝
+        const uint8_t* ref = op - offset;
+        for (size_t i = 0; i < match_len; i++)
+        {
+            op[i] = ref[i];
+        }
+        op += match_len;
+    }
+
+    return (int)(op - dst);
+}
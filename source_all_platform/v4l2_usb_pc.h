@@ -61,12 +61,19 @@ typedef int socket_t;
 #define close_socket      close
 #endif
 
-// SIMD指令集支持
-#ifdef __SSE2__
-#include <emmintrin.h>
-#endif
-#ifdef __AVX2__
+// SIMD指令集支持：x86统一包含immintrin.h，具体内核通过
+// 函数目标属性编译并在运行时按CPUID特性分发
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define UNPACK_ARCH_X86 1
 #include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define UNPACK_ARCH_NEON 1
+#include <arm_neon.h>
 #endif
 
 // ========================== 系统配置常量 ==========================
@@ -89,6 +96,18 @@ typedef int socket_t;
 /** @brief 解包线程的最小数据块大小，单位：字节 */
 #define MIN_CHUNK_SIZE (1024 * 1024)  // 1MB
 
+/** @brief 解包线程池最大工作线程数 */
+#define MAX_POOL_WORKERS 8
+
+/** @brief 帧缓冲池的缓冲区数量（接收槽位 + 解压 + 备用） */
+#define FRAME_POOL_BUFFERS 10
+
+/** @brief 帧缓冲池单个缓冲区大小（覆盖1920x1080 SBGGR10并留有余量） */
+#define FRAME_POOL_BUF_SIZE (8 * 1024 * 1024)
+
+/** @brief 帧缓冲池对齐字节数（满足AVX2对齐加载与缓存行） */
+#define FRAME_POOL_ALIGN 64
+
 // ========================== 通信协议定义 ==========================
 
 /**
@@ -109,17 +128,187 @@ struct frame_header
     uint32_t reserved[2]; /**< 保留字段，用于未来扩展 */
 } __attribute__((packed));
 
+/** @brief 条带流加入消息魔数（与设备端一致） */
+#define STRIPE_MAGIC 0xC0DE5721
+
+/** @brief 条带流最大连接数（受设备端客户端槽位限制） */
+#define MAX_STRIPE_STREAMS 4
+
+/**
+ * @struct stripe_ctrl
+ * @brief 条带流加入消息
+ *
+ * 多连接条带化传输：客户端开N条连接，每条发送本消息声明
+ * 自己是第index/count路流，设备按frame_id轮转分配帧。
+ */
+struct stripe_ctrl
+{
+    uint32_t magic; /**< 条带消息魔数：STRIPE_MAGIC */
+    uint32_t index; /**< 本连接的流序号，0..count-1 */
+    uint32_t count; /**< 条带流总数 */
+} __attribute__((packed));
+
+/** @brief 信用流控消息魔数（与设备端一致） */
+#define CREDIT_MAGIC 0xC0DEC4ED
+
+/**
+ * @struct credit_ctrl
+ * @brief 信用流控授予消息
+ *
+ * 客户端先授予一个初始窗口，之后每消费一帧补发一个信用。
+ * 设备信用耗尽时按策略丢帧，客户端卡顿不再通过TCP背压
+ * 传导到设备的采集循环。
+ */
+struct credit_ctrl
+{
+    uint32_t magic;   /**< 信用消息魔数：CREDIT_MAGIC */
+    uint32_t credits; /**< 本次授予的帧信用数 */
+} __attribute__((packed));
+
+// ========================== 容器捕获文件格式 ==========================
+
+/** @brief 容器文件魔数："VCAP"（小端） */
+#define CONTAINER_MAGIC 0x50414356u
+
+/** @brief 容器索引魔数："XDNI"（小端即"INDX"） */
+#define CONTAINER_INDEX_MAGIC 0x58444E49u
+
+/** @brief 容器格式版本号 */
+#define CONTAINER_VERSION 1
+
+/**
+ * @struct container_file_header
+ * @brief 容器文件头，位于文件起始处
+ */
+struct container_file_header
+{
+    uint32_t magic;    /**< 文件魔数：CONTAINER_MAGIC */
+    uint32_t version;  /**< 格式版本：CONTAINER_VERSION */
+    uint64_t reserved; /**< 保留字段，用于未来扩展 */
+} __attribute__((packed));
+
+/**
+ * @struct container_index_entry
+ * @brief 容器索引项，描述一帧在文件中的位置
+ *
+ * offset指向该帧frame_header记录的文件偏移，负载紧随其后。
+ */
+struct container_index_entry
+{
+    uint32_t frame_id;  /**< 帧序号 */
+    uint32_t size;      /**< 负载大小，字节 */
+    uint64_t offset;    /**< frame_header记录的文件偏移 */
+    uint64_t timestamp; /**< 嵌入式端时间戳，纳秒 */
+} __attribute__((packed));
+
+/**
+ * @struct container_trailer
+ * @brief 容器尾部结构，位于文件末尾
+ *
+ * 读取方从文件末尾回退sizeof(container_trailer)读取本结构，
+ * 再按index_offset定位索引数组，即可O(1)随机访问任意帧。
+ */
+struct container_trailer
+{
+    uint32_t magic;        /**< 索引魔数：CONTAINER_INDEX_MAGIC */
+    uint32_t entry_count;  /**< 索引项数量 */
+    uint64_t index_offset; /**< 索引数组的文件偏移 */
+} __attribute__((packed));
+
+// ========================== 共享内存帧总线 ==========================
+
+/** @brief 共享内存帧总线默认名称 */
+#define SHM_BUS_DEFAULT_NAME "v4l2_usb_frames"
+
+/** @brief 帧总线槽位数（保留最近K帧） */
+#define SHM_BUS_SLOTS 4
+
+/** @brief 帧总线单槽数据区大小（容纳解包后的16位全幅帧） */
+#define SHM_BUS_SLOT_SIZE FRAME_POOL_BUF_SIZE
+
+/** @brief 帧总线魔数："FBUS"（小端） */
+#define SHM_BUS_MAGIC 0x53554246u
+
+/** @brief 帧总线格式版本号 */
+#define SHM_BUS_VERSION 1
+
+/**
+ * @struct shm_bus_slot_header
+ * @brief 帧总线槽位头（seqlock保护）
+ *
+ * seq为奇数表示写入进行中；读取方在拷贝前后各读一次seq，
+ * 两次相等且为偶数才算读到一致的帧。
+ */
+struct shm_bus_slot_header
+{
+    volatile uint32_t seq; /**< seqlock序号，奇数=写入中 */
+    uint32_t frame_id;     /**< 帧序号 */
+    uint32_t width;        /**< 图像宽度，像素 */
+    uint32_t height;       /**< 图像高度，像素 */
+    uint32_t pixfmt;       /**< 像素格式，V4L2格式代码 */
+    uint32_t size;         /**< 槽内数据大小，字节 */
+    uint64_t timestamp;    /**< 嵌入式端时间戳，纳秒 */
+    uint8_t pad[32];       /**< 填充到64字节（独占缓存行） */
+};
+
+/**
+ * @struct shm_bus_header
+ * @brief 帧总线共享内存头，位于映射区起始处
+ *
+ * 布局：本结构（占满一页）后依次排列SHM_BUS_SLOTS个槽位，
+ * 每个槽位为shm_bus_slot_header + slot_size字节数据区。
+ */
+struct shm_bus_header
+{
+    uint32_t magic;                  /**< 总线魔数：SHM_BUS_MAGIC */
+    uint32_t version;                /**< 格式版本 */
+    uint32_t num_slots;              /**< 槽位数 */
+    uint32_t slot_size;              /**< 单槽数据区大小，字节 */
+    volatile uint32_t latest;        /**< 最近发布完成的槽位索引 */
+    uint32_t reserved;               /**< 保留字段 */
+    volatile uint64_t publish_count; /**< 已发布的帧总数 */
+};
+
+/** @brief 延迟直方图桶数（log2分桶，覆盖1us~约1小时） */
+#define PC_HIST_BUCKETS 32
+
+/**
+ * @struct latency_hist
+ * @brief log2分桶的延迟直方图（微秒）
+ */
+struct latency_hist
+{
+    uint64_t count;                    /**< 样本总数 */
+    uint64_t sum_us;                   /**< 样本总和，微秒 */
+    uint64_t max_us;                   /**< 最大样本，微秒 */
+    uint64_t buckets[PC_HIST_BUCKETS]; /**< 桶i：[2^i, 2^(i+1)) us */
+};
+
 /**
  * @struct stats
  * @brief 传输性能统计信息结构
+ *
+ * 计数器使用64位：uint32的字节计数在千兆链路上几分钟就会
+ * 回绕。丢帧通过frame_id间隙推断；设备到PC延迟以首帧建立
+ * 的时钟偏移为基准。
  */
 struct stats
 {
-    uint32_t frames_received; /**< 已接收的帧总数 */
-    uint32_t bytes_received;  /**< 已接收的字节总数 */
+    uint64_t frames_received; /**< 已接收的帧总数 */
+    uint64_t bytes_received;  /**< 已接收的字节总数（线缆字节） */
     uint64_t start_time;      /**< 程序开始时间，纳秒 */
     uint64_t last_frame_time; /**< 最后一帧接收时间，纳秒 */
     double avg_fps;           /**< 平均帧率，帧/秒 */
+    uint64_t frames_dropped;  /**< 由frame_id间隙推断的丢帧数 */
+    uint32_t last_frame_id;   /**< 最近一帧的frame_id */
+    int have_last_id;         /**< last_frame_id是否有效 */
+    int64_t clock_offset_ns;  /**< 设备-PC时钟偏移（首帧一次性估计） */
+    int have_offset;          /**< 时钟偏移是否已估计 */
+    struct latency_hist latency; /**< 设备到PC延迟分布，微秒 */
+    uint64_t stage_decomp_ns;  /**< 处理级累计LZ解压耗时，纳秒 */
+    uint64_t stage_process_ns; /**< 处理级累计转换/保存耗时，纳秒 */
+    uint64_t crc_checked;      /**< 已校验CRC32C的帧数 */
+    uint64_t crc_mismatches;   /**< CRC32C校验失败的帧数 */
 };
 
 /**
@@ -145,6 +334,16 @@ struct client_config {
     int enable_conversion;       /**< 是否启用SBGGR10转换 */
     int save_interval;           /**< 保存间隔 */
     int enable_save;             /**< 是否启用文件保存 (0=仅内存, 1=保存文件) */
+    int enable_debayer;          /**< 是否启用去马赛克RGB预览（隐含启用转换） */
+    int drop_saves;              /**< 写回队列满时丢弃保存而非阻塞 */
+    int container_mode;          /**< 所有帧追加写入单个容器文件而非逐帧文件 */
+    int publish;                 /**< 是否发布帧到共享内存总线 */
+    const char* shm_name;        /**< 共享内存总线名称 */
+    const char* csv_path;        /**< 逐帧CSV记录文件路径（NULL=不记录） */
+    int streams;                 /**< 条带流连接数（1=单流，默认） */
+    int credits;                 /**< 信用流控初始窗口帧数（0=禁用） */
+    int hugepages;               /**< 帧池/解包缓冲区用大页+NUMA绑定 */
+    int quiet;                   /**< 抑制逐帧打印（基准测试用） */
 };
 
 // ========================== 全局变量声明 ==========================
@@ -154,6 +353,11 @@ extern socket_t sock_fd;
 extern struct stats stats;
 extern uint16_t* g_unpack_buffer;
 extern size_t g_buffer_size;
+extern uint8_t* g_rgb_buffer;
+extern size_t g_rgb_buffer_size;
+
+/** @brief 大页/NUMA分配模式开关（--hugepages，init_memory_pool()前设置） */
+extern int g_hugepages_requested;
 
 // ========================== 函数声明 ==========================
 
@@ -184,14 +388,68 @@ int save_frame(const uint8_t* data, size_t size, uint32_t frame_id,
                uint32_t width, uint32_t height, uint32_t pixfmt,
                int enable_conversion, const char* output_dir);
 int process_frame_memory_only(const uint8_t* data, size_t size, uint32_t frame_id,
-                             uint32_t pixfmt, int enable_conversion);
+                             uint32_t width, uint32_t height, uint32_t pixfmt,
+                             int enable_conversion, int enable_debayer);
 void print_frame_info(const struct frame_header* header);
 
 // SBGGR10解包函数
 void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4]);
-#ifdef __AVX2__
+
+/** @brief 解包内核函数指针类型：按40字节块批量解包 */
+typedef void (*unpack_kernel_fn)(const uint8_t *raw_data, uint16_t *output,
+                                 size_t num_blocks);
+
+extern unpack_kernel_fn g_unpack_kernel;
+
+void unpack_sbggr10_blocks_scalar(const uint8_t *raw_data, uint16_t *output,
+                                  size_t num_blocks);
+
+// 负载CRC32C校验（设备在frame_header.reserved[1]携带校验和）
+/** @brief CRC32C内核函数指针类型 */
+typedef uint32_t (*crc32c_fn)(const uint8_t *data, size_t size);
+
+extern crc32c_fn g_crc32c;
+
+uint32_t crc32c_soft(const uint8_t *data, size_t size);
+#ifdef UNPACK_ARCH_X86
+uint32_t crc32c_sse42(const uint8_t *data, size_t size);
+#endif
+#if defined(UNPACK_ARCH_NEON) && defined(__ARM_FEATURE_CRC32)
+uint32_t crc32c_armv8(const uint8_t *data, size_t size);
+#endif
+
+#ifdef UNPACK_ARCH_X86
 void unpack_sbggr10_avx2(const uint8_t *raw_data, uint16_t *output, size_t num_blocks);
+void unpack_sbggr10_ssse3(const uint8_t *raw_data, uint16_t *output, size_t num_blocks);
+#endif
+#ifdef UNPACK_ARCH_NEON
+void unpack_sbggr10_neon(const uint8_t *raw_data, uint16_t *output, size_t num_blocks);
+#endif
+void select_unpack_kernel(void);
+
+// BGGR去马赛克（双线性，输出RGB888）
+/** @brief 去马赛克行内核函数指针类型：处理一整行输出 */
+typedef void (*debayer_row_fn)(const uint16_t* up, const uint16_t* cur,
+                               const uint16_t* dn, uint8_t* rgb,
+                               uint32_t width, int odd_row);
+
+extern debayer_row_fn g_debayer_row;
+
+void debayer_row_scalar(const uint16_t* up, const uint16_t* cur,
+                        const uint16_t* dn, uint8_t* rgb,
+                        uint32_t width, int odd_row);
+#ifdef UNPACK_ARCH_X86
+void debayer_row_avx2(const uint16_t* up, const uint16_t* cur,
+                      const uint16_t* dn, uint8_t* rgb,
+                      uint32_t width, int odd_row);
 #endif
+#ifdef UNPACK_ARCH_NEON
+void debayer_row_neon(const uint16_t* up, const uint16_t* cur,
+                      const uint16_t* dn, uint8_t* rgb,
+                      uint32_t width, int odd_row);
+#endif
+int debayer_bggr10_to_rgb888(const uint16_t* bayer, uint8_t* rgb,
+                             uint32_t width, uint32_t height);
 #ifdef _WIN32
 unsigned int __stdcall unpack_worker_thread(void *arg);
 #else
@@ -201,11 +459,15 @@ int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size,
                         uint16_t *output_pixels, size_t num_pixels);
 
 // 性能统计函数
-void update_stats(uint32_t frame_size);
+void update_stats(const struct frame_header* header);
 void print_stats(void);
+int stats_csv_open(const char* path);
+void stats_csv_close(void);
 
 // 主接收循环
 int receive_loop(socket_t sock, const struct client_config* config);
+int receive_loop_striped(socket_t* socks, int num_streams,
+                         const struct client_config* config);
 
 // 命令行界面函数
 void print_usage(const char* prog_name);
@@ -215,4 +477,39 @@ int parse_arguments(int argc, char* argv[], struct client_config* config);
 void init_memory_pool(void);
 void cleanup_memory_pool(void);
 
+// 帧缓冲池
+void frame_pool_init(void);
+void frame_pool_destroy(void);
+uint8_t* frame_pool_acquire(size_t size);
+void frame_pool_release(uint8_t* buf);
+
+// 解包线程池
+void unpack_pool_init(void);
+void unpack_pool_init_n(int workers);
+void unpack_pool_destroy(void);
+void unpack_pool_run(const uint8_t *raw_data, size_t raw_size,
+                     uint16_t *output, int slices);
+
+// 异步落盘队列
+void writeback_init(int drop_on_full);
+void writeback_destroy(void);
+
+// 容器捕获文件
+int container_open(const char* output_dir);
+int container_append(const struct frame_header* header,
+                     const uint8_t* data, size_t size);
+void container_close(void);
+
+// 共享内存帧总线（发布端）
+int shm_bus_create(const char* name);
+void shm_bus_publish(const struct frame_header* header,
+                     const uint8_t* data, size_t size, int convert);
+void shm_bus_destroy(void);
+
+// 共享内存帧总线（订阅端，供分析软件链接使用）
+int shm_bus_open(const char* name);
+int shm_bus_read_latest(struct frame_header* header,
+                        uint8_t* out, size_t max_size);
+void shm_bus_close(void);
+
 #endif // V4L2_USB_PC_H
@@ -10,9 +10,14 @@
  */
 
 #include "v4l2_usb_pc.h"
+#include "v4l2_lz.h"
 #include <errno.h>
 #include <signal.h>
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 
 // ========================== 全局状态变量 ==========================
 
@@ -29,6 +34,16 @@ struct stats stats = {0};
 uint16_t* g_unpack_buffer = NULL;
 size_t g_buffer_size = 0;
 
+/** @brief 解包缓冲区的大页映射长度（0=普通分配） */
+static size_t g_unpack_buffer_mapped = 0;
+
+/** @brief 全局内存池 - 去马赛克RGB888缓冲区 */
+uint8_t* g_rgb_buffer = NULL;
+size_t g_rgb_buffer_size = 0;
+
+/** @brief RGB缓冲区的大页映射长度（0=普通分配） */
+static size_t g_rgb_buffer_mapped = 0;
+
 // ========================== 跨平台工具函数 ==========================
 
 /**
@@ -291,6 +306,198 @@ socket_t connect_to_server(const char* ip, int port)
     return sock;
 }
 
+// ========================== 大页与NUMA感知分配 ==========================
+
+static uint8_t* aligned_alloc_64(size_t size);
+static void aligned_free_64(uint8_t* ptr);
+
+/** @brief 大页/NUMA分配模式是否启用（--hugepages，启动时设置） */
+int g_hugepages_requested = 0;
+
+#ifdef __linux__
+
+#include <sys/syscall.h>
+
+/** @brief 透明大页尺寸：2MB */
+#define HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+// 不依赖libnuma：mbind走裸系统调用，策略常量本地定义
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/** @brief 绑定的NUMA节点，-1表示单节点机器或未探测 */
+static int g_numa_node = -1;
+
+/** @brief 绑定节点的CPU集合（解包线程亲和性用） */
+static cpu_set_t g_numa_cpuset;
+
+/**
+ * @brief 探测接收线程所在的NUMA节点并解析其CPU列表
+ *
+ * 单节点机器上不做任何绑定（内核默认即本地分配）。多节点时
+ * 记下当前线程运行的节点：后续池缓冲区都绑定到该节点，解包
+ * 线程也固定在该节点的CPU上，消除跨socket访问。
+ */
+static void numa_setup(void)
+{
+    static int probed = 0;
+    if (probed) {
+        return;
+    }
+    probed = 1;
+
+    // node1不存在说明只有一个节点，绑定没有意义
+    if (access("/sys/devices/system/node/node1", F_OK) != 0) {
+        return;
+    }
+
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(__NR_getcpu, &cpu, &node, NULL) != 0) {
+        return;
+    }
+
+    char path[128];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/node/node%u/cpulist", node);
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return;
+    }
+
+    char list[256];
+    if (!fgets(list, sizeof(list), fp)) {
+        fclose(fp);
+        return;
+    }
+    fclose(fp);
+
+    // 解析形如"0-7,16-23"的CPU列表
+    CPU_ZERO(&g_numa_cpuset);
+    char* save = NULL;
+    for (char* tok = strtok_r(list, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        int lo = -1;
+        int hi = -1;
+        if (sscanf(tok, "%d-%d", &lo, &hi) == 1) {
+            hi = lo;
+        }
+        for (int c = lo; c >= 0 && c <= hi && c < CPU_SETSIZE; c++) {
+            CPU_SET(c, &g_numa_cpuset);
+        }
+    }
+
+    g_numa_node = (int)node;
+    printf("NUMA binding: node %u (receive thread CPU %u)\n", node, cpu);
+}
+
+/**
+ * @brief 把一段映射绑定到接收线程所在的NUMA节点
+ */
+static void numa_bind_memory(void* ptr, size_t len)
+{
+    if (g_numa_node < 0) {
+        return;
+    }
+
+    unsigned long nodemask = 1UL << g_numa_node;
+    syscall(__NR_mbind, ptr, len, MPOL_PREFERRED, &nodemask,
+            sizeof(nodemask) * 8, 0);
+}
+
+/**
+ * @brief 把一个线程固定到绑定节点的CPU集合上
+ */
+static void numa_pin_thread(pthread_t thread)
+{
+    if (g_numa_node < 0) {
+        return;
+    }
+
+    pthread_setaffinity_np(thread, sizeof(g_numa_cpuset), &g_numa_cpuset);
+}
+
+#endif // __linux__
+
+/**
+ * @brief 分配一块大型常驻缓冲区（帧池/解包/RGB缓冲区共用）
+ *
+ * 大页模式下改用2MB对齐的匿名映射并madvise(MADV_HUGEPAGE)，
+ * 由透明大页机制合并页表项；多NUMA节点时先绑定到接收线程所在
+ * 节点再预触碰，保证物理页落在本地。模式关闭或映射失败时回退
+ * 到原有的64字节对齐分配。
+ *
+ * @param size 请求的字节数
+ * @param mapped_out 返回实际映射长度，0表示走的回退分配
+ * @return 缓冲区指针，失败返回NULL
+ */
+static uint8_t* big_buffer_alloc(size_t size, size_t* mapped_out)
+{
+    *mapped_out = 0;
+
+#if defined(__linux__)
+    if (g_hugepages_requested) {
+        numa_setup();
+        size_t len = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        void* ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED) {
+            madvise(ptr, len, MADV_HUGEPAGE);
+            numa_bind_memory(ptr, len);
+            // 绑定后预触碰：物理页按当前策略落到目标节点
+            memset(ptr, 0, len);
+            *mapped_out = len;
+            return (uint8_t*)ptr;
+        }
+        printf("Warning: huge-page mapping failed, using malloc\n");
+    }
+#elif defined(_WIN32)
+    if (g_hugepages_requested) {
+        size_t large = GetLargePageMinimum();
+        if (large > 0) {
+            size_t len = (size + large - 1) & ~(large - 1);
+            void* ptr = VirtualAlloc(NULL, len,
+                                     MEM_RESERVE | MEM_COMMIT |
+                                     MEM_LARGE_PAGES,
+                                     PAGE_READWRITE);
+            if (ptr) {
+                *mapped_out = len;
+                return (uint8_t*)ptr;
+            }
+        }
+        // 大页需要SeLockMemoryPrivilege，拿不到时回退普通分配
+        printf("Warning: large-page allocation failed, using malloc\n");
+    }
+#endif
+
+    return aligned_alloc_64(size);
+}
+
+/**
+ * @brief 释放big_buffer_alloc()分配的缓冲区
+ *
+ * @param ptr 缓冲区指针
+ * @param mapped 分配时返回的映射长度
+ */
+static void big_buffer_free(uint8_t* ptr, size_t mapped)
+{
+    if (!ptr) {
+        return;
+    }
+
+    if (mapped > 0) {
+#if defined(__linux__)
+        munmap(ptr, mapped);
+#elif defined(_WIN32)
+        VirtualFree(ptr, 0, MEM_RELEASE);
+#endif
+        return;
+    }
+
+    aligned_free_64(ptr);
+}
+
 // ========================== 内存管理函数 ==========================
 
 /**
@@ -298,17 +505,39 @@ socket_t connect_to_server(const char* ip, int port)
  */
 void init_memory_pool(void)
 {
+#ifdef __linux__
+    // 大页模式下先确定接收线程所在节点，后续分配与线程都跟随它
+    if (g_hugepages_requested) {
+        numa_setup();
+    }
+#endif
+
+    // 按CPU特性选定解包内核并启动常驻解包线程池
+    select_unpack_kernel();
+    unpack_pool_init();
+
     // 预分配8MB解包缓冲区
     g_buffer_size = 8 * 1024 * 1024 / sizeof(uint16_t);
-    g_unpack_buffer = (uint16_t*)malloc(g_buffer_size * sizeof(uint16_t));
-    
+    g_unpack_buffer = (uint16_t*)big_buffer_alloc(
+        g_buffer_size * sizeof(uint16_t), &g_unpack_buffer_mapped);
+
     if (g_unpack_buffer) {
-        printf("Memory pool initialized: %.1f MB\n", 
-               (g_buffer_size * sizeof(uint16_t)) / (1024.0 * 1024.0));
+        printf("Memory pool initialized: %.1f MB%s\n",
+               (g_buffer_size * sizeof(uint16_t)) / (1024.0 * 1024.0),
+               g_unpack_buffer_mapped ? " (huge pages)" : "");
     } else {
         printf("Warning: Failed to allocate memory pool\n");
         g_buffer_size = 0;
     }
+
+    // 预分配去马赛克RGB输出缓冲区（1920x1080x3有余量）
+    g_rgb_buffer_size = 8 * 1024 * 1024;
+    g_rgb_buffer = (uint8_t*)big_buffer_alloc(g_rgb_buffer_size,
+                                              &g_rgb_buffer_mapped);
+    if (!g_rgb_buffer) {
+        printf("Warning: Failed to allocate RGB buffer\n");
+        g_rgb_buffer_size = 0;
+    }
 }
 
 /**
@@ -316,12 +545,187 @@ void init_memory_pool(void)
  */
 void cleanup_memory_pool(void)
 {
+    unpack_pool_destroy();
+
     if (g_unpack_buffer) {
-        free(g_unpack_buffer);
+        big_buffer_free((uint8_t*)g_unpack_buffer, g_unpack_buffer_mapped);
         g_unpack_buffer = NULL;
         g_buffer_size = 0;
+        g_unpack_buffer_mapped = 0;
         printf("Memory pool cleaned up\n");
     }
+
+    big_buffer_free(g_rgb_buffer, g_rgb_buffer_mapped);
+    g_rgb_buffer = NULL;
+    g_rgb_buffer_size = 0;
+    g_rgb_buffer_mapped = 0;
+}
+
+// ========================== 帧缓冲池 ==========================
+
+/**
+ * @brief 跨平台64字节对齐分配
+ */
+static uint8_t* aligned_alloc_64(size_t size)
+{
+#ifdef _WIN32
+    return (uint8_t*)_aligned_malloc(size, FRAME_POOL_ALIGN);
+#else
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, FRAME_POOL_ALIGN, size) != 0) {
+        return NULL;
+    }
+    return (uint8_t*)ptr;
+#endif
+}
+
+/**
+ * @brief 释放64字节对齐分配的内存
+ */
+static void aligned_free_64(uint8_t* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/**
+ * @struct frame_pool
+ * @brief 接收路径的固定帧缓冲池
+ *
+ * 启动时一次性分配固定数量的最大帧尺寸缓冲区，接收线程逐帧
+ * 取用、处理线程用完归还，热路径上不再触碰系统分配器，也没有
+ * 首次写入的缺页开销。64字节对齐让SIMD解包内核得到对齐加载。
+ * 超过池缓冲区尺寸的帧回退到单次对齐分配（按地址判别归还）。
+ */
+struct frame_pool {
+    uint8_t* buffers[FRAME_POOL_BUFFERS]; /**< 所有池缓冲区的基地址 */
+    size_t mapped[FRAME_POOL_BUFFERS];    /**< 各缓冲区的大页映射长度 */
+    uint8_t* free_list[FRAME_POOL_BUFFERS]; /**< 空闲缓冲区栈 */
+    int free_count;                       /**< 空闲缓冲区数量 */
+    int initialized;                      /**< 池是否已初始化 */
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+/** @brief 全局帧缓冲池 */
+static struct frame_pool g_frame_pool;
+
+#ifdef _WIN32
+#define fp_lock()   EnterCriticalSection(&g_frame_pool.lock)
+#define fp_unlock() LeaveCriticalSection(&g_frame_pool.lock)
+#else
+#define fp_lock()   pthread_mutex_lock(&g_frame_pool.lock)
+#define fp_unlock() pthread_mutex_unlock(&g_frame_pool.lock)
+#endif
+
+/**
+ * @brief 启动时一次性分配帧缓冲池
+ */
+void frame_pool_init(void)
+{
+    memset(&g_frame_pool, 0, sizeof(g_frame_pool));
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_frame_pool.lock);
+#else
+    pthread_mutex_init(&g_frame_pool.lock, NULL);
+#endif
+
+    for (int i = 0; i < FRAME_POOL_BUFFERS; i++) {
+        g_frame_pool.buffers[i] =
+            big_buffer_alloc(FRAME_POOL_BUF_SIZE, &g_frame_pool.mapped[i]);
+        if (!g_frame_pool.buffers[i]) {
+            printf("Warning: Frame pool allocation failed at buffer %d\n", i);
+            break;
+        }
+        // 预触碰页面，把缺页开销留在启动阶段（大页路径已触碰）
+        if (g_frame_pool.mapped[i] == 0) {
+            memset(g_frame_pool.buffers[i], 0, FRAME_POOL_BUF_SIZE);
+        }
+        g_frame_pool.free_list[g_frame_pool.free_count++] = g_frame_pool.buffers[i];
+    }
+
+    g_frame_pool.initialized = 1;
+    printf("Frame pool initialized: %d x %.1f MB (%s)\n",
+           g_frame_pool.free_count,
+           FRAME_POOL_BUF_SIZE / (1024.0 * 1024.0),
+           g_frame_pool.mapped[0] ? "huge pages" : "64-byte aligned");
+}
+
+/**
+ * @brief 从池中取用一个帧缓冲区
+ *
+ * 池未初始化、已取空或请求尺寸超过池缓冲区时，回退到
+ * 单次对齐分配，frame_pool_release按地址识别后free。
+ */
+uint8_t* frame_pool_acquire(size_t size)
+{
+    if (g_frame_pool.initialized && size <= FRAME_POOL_BUF_SIZE) {
+        fp_lock();
+        if (g_frame_pool.free_count > 0) {
+            uint8_t* buf = g_frame_pool.free_list[--g_frame_pool.free_count];
+            fp_unlock();
+            return buf;
+        }
+        fp_unlock();
+    }
+
+    return aligned_alloc_64(size);
+}
+
+/**
+ * @brief 归还帧缓冲区
+ */
+void frame_pool_release(uint8_t* buf)
+{
+    if (!buf) {
+        return;
+    }
+
+    if (g_frame_pool.initialized) {
+        for (int i = 0; i < FRAME_POOL_BUFFERS; i++) {
+            if (buf == g_frame_pool.buffers[i]) {
+                fp_lock();
+                g_frame_pool.free_list[g_frame_pool.free_count++] = buf;
+                fp_unlock();
+                return;
+            }
+        }
+    }
+
+    // 池外的回退分配
+    aligned_free_64(buf);
+}
+
+/**
+ * @brief 释放帧缓冲池
+ */
+void frame_pool_destroy(void)
+{
+    if (!g_frame_pool.initialized) {
+        return;
+    }
+
+    for (int i = 0; i < FRAME_POOL_BUFFERS; i++) {
+        big_buffer_free(g_frame_pool.buffers[i], g_frame_pool.mapped[i]);
+        g_frame_pool.buffers[i] = NULL;
+        g_frame_pool.mapped[i] = 0;
+    }
+    g_frame_pool.free_count = 0;
+    g_frame_pool.initialized = 0;
+
+#ifdef _WIN32
+    DeleteCriticalSection(&g_frame_pool.lock);
+#else
+    pthread_mutex_destroy(&g_frame_pool.lock);
+#endif
 }
 
 // ========================== SBGGR10解包函数 ==========================
@@ -344,157 +748,2310 @@ void unpack_sbggr10_scalar(const uint8_t raw_bytes[5], uint16_t pixels[4]) {
     pixels[3] = (uint16_t)((combined >> 30) & 0x3FF);
 }
 
-#ifdef __AVX2__
 /**
- * @brief SBGGR10格式数据解包（AVX2优化版本）
+ * @brief SBGGR10格式数据解包（标量版本，按40字节块批量）
+ *
+ * 运行时分发的兜底内核，任何平台都可用。
  */
-void unpack_sbggr10_avx2(const uint8_t *raw_data, uint16_t *output, size_t num_blocks) {
+void unpack_sbggr10_blocks_scalar(const uint8_t *raw_data, uint16_t *output,
+                                  size_t num_blocks) {
     for (size_t block = 0; block < num_blocks; block++) {
         const uint8_t *src = raw_data + block * 40;
         uint16_t *dst = output + block * 32;
-        
-        // 暂时使用标量版本的循环展开
+
         for (int i = 0; i < 8; i++) {
             unpack_sbggr10_scalar(src + i * 5, dst + i * 4);
         }
     }
 }
-#endif
 
-/**
- * @brief 图像解包工作线程函数
+/*
+ * 向量化内核的共同思路：每20个输入字节含4个5字节组（16个像素）。
+ * 字节shuffle把每个像素的两个来源字节拼成一个16位字，此时像素值
+ * 位于字内偏移0/2/4/6比特处；按lane乘以(1<<(6-偏移))再统一右移6位
+ * 完成对齐（16位截断不影响低10位），最后与0x3FF得到像素值。
+ * 每次迭代会越过当前20字节多读若干字节，因此最后一个40字节块
+ * 始终走标量路径，避免读越输入缓冲区末尾。
  */
-#ifdef _WIN32
-unsigned int __stdcall unpack_worker_thread(void *arg) {
+
+#ifdef UNPACK_ARCH_X86
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define UNPACK_TARGET(x) __attribute__((target(x)))
+#elif defined(__clang__)
+#define UNPACK_TARGET(x) __attribute__((target(x)))
 #else
-void* unpack_worker_thread(void *arg) {
+#define UNPACK_TARGET(x)
 #endif
-    struct unpack_task *task = (struct unpack_task*)arg;
-    
-    size_t raw_pos = task->start_offset;
-    size_t pixel_pos = task->start_offset / 5 * 4;
-    
-#ifdef __AVX2__
-    // AVX2优化：批量处理8个5字节块
-    size_t avx2_blocks = (task->end_offset - raw_pos) / 40;
-    if (avx2_blocks > 0) {
-        unpack_sbggr10_avx2(task->raw_data + raw_pos, 
-                           task->output_data + pixel_pos, 
-                           avx2_blocks);
-        raw_pos += avx2_blocks * 40;
-        pixel_pos += avx2_blocks * 32;
+
+/**
+ * @brief SBGGR10格式数据解包（AVX2版本）
+ *
+ * 每次迭代处理20字节（两个128位lane各10字节）展开为16个像素，
+ * 一个40字节块两次迭代，共两条256位store。
+ */
+UNPACK_TARGET("avx2")
+void unpack_sbggr10_avx2(const uint8_t *raw_data, uint16_t *output, size_t num_blocks) {
+    if (num_blocks == 0) {
+        return;
     }
-#endif
-    
-    // 处理剩余的5字节块（标量版本）
-    while (raw_pos + 5 <= task->end_offset) {
-        unpack_sbggr10_scalar(task->raw_data + raw_pos, 
-                             task->output_data + pixel_pos);
-        raw_pos += 5;
-        pixel_pos += 4;
+
+    // 每lane的shuffle控制：像素i由字节对(b[i],b[i+1])等构成
+    const __m256i shuf = _mm256_setr_epi8(
+        0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9,
+        0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9);
+    const __m256i mult = _mm256_setr_epi16(
+        64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1);
+    const __m256i mask = _mm256_set1_epi16(0x3FF);
+
+    // 最后一个块留给标量路径，防止lane加载读越缓冲区末尾
+    size_t vec_blocks = num_blocks - 1;
+    for (size_t block = 0; block < vec_blocks; block++) {
+        const uint8_t *src = raw_data + block * 40;
+        uint16_t *dst = output + block * 32;
+
+        for (int half = 0; half < 2; half++) {
+            __m256i in = _mm256_set_m128i(
+                _mm_loadu_si128((const __m128i*)(src + half * 20 + 10)),
+                _mm_loadu_si128((const __m128i*)(src + half * 20)));
+            __m256i words = _mm256_shuffle_epi8(in, shuf);
+            __m256i aligned =
+                _mm256_srli_epi16(_mm256_mullo_epi16(words, mult), 6);
+            _mm256_storeu_si256((__m256i*)(dst + half * 16),
+                                _mm256_and_si256(aligned, mask));
+        }
     }
-    
-#ifdef _WIN32
-    return 0;
-#else
-    return NULL;
-#endif
+
+    unpack_sbggr10_blocks_scalar(raw_data + vec_blocks * 40,
+                                 output + vec_blocks * 32, 1);
 }
 
 /**
- * @brief 多线程SBGGR10图像数据解包主函数
+ * @brief SBGGR10格式数据解包（SSSE3版本）
+ *
+ * 128位寄存器版本，每次迭代处理10字节展开为8个像素。
+ * 字节shuffle依赖pshufb，因此要求SSSE3而非纯SSE2。
  */
-int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size, 
-                        uint16_t *output_pixels, size_t num_pixels) {
-    if (!raw_data || !output_pixels || raw_size == 0) {
-        return -1;
-    }
-    
-    // 验证数据大小（必须是5的倍数）
-    if (raw_size % 5 != 0) {
-        printf("Error: RAW data size (%zu) must be multiple of 5\n", raw_size);
-        return -1;
+UNPACK_TARGET("ssse3")
+void unpack_sbggr10_ssse3(const uint8_t *raw_data, uint16_t *output, size_t num_blocks) {
+    if (num_blocks == 0) {
+        return;
     }
-    
-    size_t expected_pixels = raw_size / 5 * 4;
-    if (num_pixels < expected_pixels) {
-        printf("Error: Output buffer too small (%zu < %zu)\n", num_pixels, expected_pixels);
-        return -1;
+
+    const __m128i shuf = _mm_setr_epi8(
+        0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9);
+    const __m128i mult = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+    const __m128i mask = _mm_set1_epi16(0x3FF);
+
+    size_t vec_blocks = num_blocks - 1;
+    for (size_t block = 0; block < vec_blocks; block++) {
+        const uint8_t *src = raw_data + block * 40;
+        uint16_t *dst = output + block * 32;
+
+        for (int q = 0; q < 4; q++) {
+            __m128i in = _mm_loadu_si128((const __m128i*)(src + q * 10));
+            __m128i words = _mm_shuffle_epi8(in, shuf);
+            __m128i aligned = _mm_srli_epi16(_mm_mullo_epi16(words, mult), 6);
+            _mm_storeu_si128((__m128i*)(dst + q * 8),
+                             _mm_and_si128(aligned, mask));
+        }
     }
-    
-    // 获取CPU核心数，决定线程数量
-    int cpu_cores = get_cpu_cores();
-    int num_threads = (raw_size < MIN_CHUNK_SIZE) ? 1 : cpu_cores;
-    
-    if (num_threads > 8) num_threads = 8;  // 限制最大线程数
-    
-    // 单线程处理小数据量
-    if (num_threads == 1) {
-        struct unpack_task task = {
-            .raw_data = raw_data,
-            .output_data = output_pixels,
-            .start_offset = 0,
-            .end_offset = raw_size,
-            .thread_id = 0
-        };
-        unpack_worker_thread(&task);
-        return 0;
+
+    unpack_sbggr10_blocks_scalar(raw_data + vec_blocks * 40,
+                                 output + vec_blocks * 32, 1);
+}
+
+#endif  // UNPACK_ARCH_X86
+
+#ifdef UNPACK_ARCH_NEON
+/**
+ * @brief SBGGR10格式数据解包（NEON版本）
+ *
+ * 与x86版本同构：表查找拼字节对，vshlq_u16负移位完成对齐。
+ */
+void unpack_sbggr10_neon(const uint8_t *raw_data, uint16_t *output, size_t num_blocks) {
+    if (num_blocks == 0) {
+        return;
     }
-    
-    // 多线程处理
-    struct unpack_task tasks[8];
-    size_t chunk_size = raw_size / num_threads;
-    chunk_size = (chunk_size / 5) * 5;  // 确保5字节对齐
-    
-#ifdef _WIN32
-    HANDLE threads[8];
+
+    static const uint8_t shuf_idx[16] = {0, 1, 1, 2, 2, 3, 3, 4,
+                                         5, 6, 6, 7, 7, 8, 8, 9};
+    static const int16_t shift_amt[8] = {0, -2, -4, -6, 0, -2, -4, -6};
+
+    const uint8x16_t shuf = vld1q_u8(shuf_idx);
+    const int16x8_t shifts = vld1q_s16(shift_amt);
+    const uint16x8_t mask = vdupq_n_u16(0x3FF);
+
+    size_t vec_blocks = num_blocks - 1;
+    for (size_t block = 0; block < vec_blocks; block++) {
+        const uint8_t *src = raw_data + block * 40;
+        uint16_t *dst = output + block * 32;
+
+        for (int q = 0; q < 4; q++) {
+            uint8x16_t in = vld1q_u8(src + q * 10);
+#ifdef __aarch64__
+            uint8x16_t gathered = vqtbl1q_u8(in, shuf);
 #else
-    pthread_t threads[8];
+            uint8x8x2_t tab = {{vget_low_u8(in), vget_high_u8(in)}};
+            uint8x16_t gathered =
+                vcombine_u8(vtbl2_u8(tab, vget_low_u8(shuf)),
+                            vtbl2_u8(tab, vget_high_u8(shuf)));
 #endif
+            uint16x8_t words = vreinterpretq_u16_u8(gathered);
+            uint16x8_t aligned = vshlq_u16(words, shifts);
+            vst1q_u16(dst + q * 8, vandq_u16(aligned, mask));
+        }
+    }
+
+    unpack_sbggr10_blocks_scalar(raw_data + vec_blocks * 40,
+                                 output + vec_blocks * 32, 1);
+}
+#endif  // UNPACK_ARCH_NEON
+
+// ========================== 负载CRC32C校验 ==========================
+
+/**
+ * @brief CRC32C软件实现（slice-by-8）
+ *
+ * 查找表在首次调用时生成（仅处理线程调用，无并发问题）。
+ */
+uint32_t crc32c_soft(const uint8_t *data, size_t size)
+{
+    static uint32_t table[8][256];
+    static int table_ready = 0;
+
+    if (!table_ready) {
+        const uint32_t poly = 0x82F63B78u;  // Castagnoli反射多项式
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                table[t][i] = (table[t - 1][i] >> 8) ^
+                              table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+        table_ready = 1;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint32_t lo = crc ^ ((uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+                             ((uint32_t)data[i + 2] << 16) |
+                             ((uint32_t)data[i + 3] << 24));
+        uint32_t hi = (uint32_t)data[i + 4] | ((uint32_t)data[i + 5] << 8) |
+                      ((uint32_t)data[i + 6] << 16) |
+                      ((uint32_t)data[i + 7] << 24);
+
+        crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+              table[5][(lo >> 16) & 0xFF] ^ table[4][(lo >> 24) & 0xFF] ^
+              table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+              table[1][(hi >> 16) & 0xFF] ^ table[0][(hi >> 24) & 0xFF];
+    }
+    for (; i < size; i++) {
+        crc = (crc >> 8) ^ table[0][(crc ^ data[i]) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+#ifdef UNPACK_ARCH_X86
+/**
+ * @brief CRC32C硬件实现（SSE4.2 crc32指令，8字节/迭代）
+ */
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32c_sse42(const uint8_t *data, size_t size)
+{
+    uint64_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        crc = _mm_crc32_u64(crc, v);
+    }
+    for (; i < size; i++) {
+        crc = _mm_crc32_u8((uint32_t)crc, data[i]);
+    }
+    return (uint32_t)crc ^ 0xFFFFFFFFu;
+}
+#endif
+
+#if defined(UNPACK_ARCH_NEON) && defined(__ARM_FEATURE_CRC32)
+/**
+ * @brief CRC32C硬件实现（ARMv8 CRC扩展指令）
+ */
+uint32_t crc32c_armv8(const uint8_t *data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for (; i < size; i++) {
+        crc = __crc32cb(crc, data[i]);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+#endif
+
+/** @brief 当前CRC32C内核，select_unpack_kernel()中按CPU特性切换 */
+crc32c_fn g_crc32c = crc32c_soft;
+
+/** @brief 当前选定的解包内核，启动时由select_unpack_kernel()设置 */
+unpack_kernel_fn g_unpack_kernel = unpack_sbggr10_blocks_scalar;
+
+/**
+ * @brief 按运行时CPU特性选择最优解包内核
+ *
+ * x86上通过CPUID检测AVX2/SSSE3（而非仅依赖编译期宏），
+ * ARM平台编译期有NEON即选用NEON内核，否则回退标量版本。
+ */
+void select_unpack_kernel(void) {
+    const char* name = "scalar";
+    const char* debayer_name = "scalar";
+    const char* crc_name = "slice-by-8";
+
+#ifdef UNPACK_ARCH_X86
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    int max_leaf = regs[0];
+
+    __cpuid(regs, 1);
+    int has_ssse3 = (regs[2] >> 9) & 1;
+
+    int has_avx2 = 0;
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        has_avx2 = (regs[1] >> 5) & 1;
+    }
+#else
+    int has_ssse3 = __builtin_cpu_supports("ssse3");
+    int has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (has_avx2) {
+        g_unpack_kernel = unpack_sbggr10_avx2;
+        name = "AVX2";
+        g_debayer_row = debayer_row_avx2;
+        debayer_name = "AVX2";
+    } else if (has_ssse3) {
+        g_unpack_kernel = unpack_sbggr10_ssse3;
+        name = "SSSE3";
+    }
+
+#ifdef _MSC_VER
+    __cpuid(regs, 1);
+    int has_sse42 = (regs[2] >> 20) & 1;
+#else
+    int has_sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+    if (has_sse42) {
+        g_crc32c = crc32c_sse42;
+        crc_name = "SSE4.2";
+    }
+#elif defined(UNPACK_ARCH_NEON)
+    g_unpack_kernel = unpack_sbggr10_neon;
+    name = "NEON";
+    g_debayer_row = debayer_row_neon;
+    debayer_name = "NEON";
+#ifdef __ARM_FEATURE_CRC32
+    g_crc32c = crc32c_armv8;
+    crc_name = "ARMv8";
+#endif
+#endif
+
+    printf("SBGGR10 unpack kernel: %s\n", name);
+    printf("BGGR debayer kernel: %s\n", debayer_name);
+    printf("CRC32C kernel: %s\n", crc_name);
+}
+
+/**
+ * @brief 图像解包工作线程函数
+ */
+#ifdef _WIN32
+unsigned int __stdcall unpack_worker_thread(void *arg) {
+#else
+void* unpack_worker_thread(void *arg) {
+#endif
+    struct unpack_task *task = (struct unpack_task*)arg;
+
+    size_t raw_pos = task->start_offset;
+    size_t pixel_pos = task->start_offset / 5 * 4;
+
+    // 运行时选定的SIMD内核批量处理40字节块
+    size_t simd_blocks = (task->end_offset - raw_pos) / 40;
+    if (simd_blocks > 0) {
+        g_unpack_kernel(task->raw_data + raw_pos,
+                        task->output_data + pixel_pos,
+                        simd_blocks);
+        raw_pos += simd_blocks * 40;
+        pixel_pos += simd_blocks * 32;
+    }
+
+    // 处理剩余的5字节块（标量版本）
+    while (raw_pos + 5 <= task->end_offset) {
+        unpack_sbggr10_scalar(task->raw_data + raw_pos,
+                             task->output_data + pixel_pos);
+        raw_pos += 5;
+        pixel_pos += 4;
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// ========================== 解包线程池 ==========================
+
+/**
+ * @struct unpack_pool
+ * @brief 常驻解包线程池
+ *
+ * 工作线程启动一次后常驻，停靠在条件变量上等待任务，
+ * 避免每帧pthread_create/_beginthreadex的创建开销。
+ * 每个任务被静态切分为多个切片，工作线程在锁内领取
+ * 切片索引、锁外解包，天然实现切片级负载均衡。
+ */
+struct unpack_pool {
+    int num_workers;         /**< 工作线程数，0表示池未启用 */
+    int shutdown;            /**< 关闭标志 */
+
+    const uint8_t* raw_data; /**< 当前任务输入数据 */
+    uint16_t* output_data;   /**< 当前任务输出缓冲区 */
+    size_t raw_size;         /**< 当前任务输入大小 */
+    size_t slice_size;       /**< 切片大小（5字节对齐） */
+    int num_slices;          /**< 当前任务切片总数 */
+    int next_slice;          /**< 下一个待领取的切片索引 */
+    int slices_done;         /**< 已完成的切片数 */
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;      /**< 任务状态互斥 */
+    CONDITION_VARIABLE work_cv; /**< 工作线程等待新任务 */
+    CONDITION_VARIABLE done_cv; /**< 提交线程等待任务完成 */
+    HANDLE threads[MAX_POOL_WORKERS];
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    pthread_t threads[MAX_POOL_WORKERS];
+#endif
+};
+
+/** @brief 全局解包线程池 */
+static struct unpack_pool g_pool = {0};
+
+/** @brief 加锁/解锁/等待/唤醒的跨平台封装 */
+#ifdef _WIN32
+#define pool_lock()        EnterCriticalSection(&g_pool.lock)
+#define pool_unlock()      LeaveCriticalSection(&g_pool.lock)
+#define pool_wait_work()   SleepConditionVariableCS(&g_pool.work_cv, &g_pool.lock, INFINITE)
+#define pool_wait_done()   SleepConditionVariableCS(&g_pool.done_cv, &g_pool.lock, INFINITE)
+#define pool_wake_workers() WakeAllConditionVariable(&g_pool.work_cv)
+#define pool_wake_done()   WakeConditionVariable(&g_pool.done_cv)
+#else
+#define pool_lock()        pthread_mutex_lock(&g_pool.lock)
+#define pool_unlock()      pthread_mutex_unlock(&g_pool.lock)
+#define pool_wait_work()   pthread_cond_wait(&g_pool.work_cv, &g_pool.lock)
+#define pool_wait_done()   pthread_cond_wait(&g_pool.done_cv, &g_pool.lock)
+#define pool_wake_workers() pthread_cond_broadcast(&g_pool.work_cv)
+#define pool_wake_done()   pthread_cond_signal(&g_pool.done_cv)
+#endif
+
+/**
+ * @brief 解包一个切片（领取到切片索引后在锁外执行）
+ */
+static void unpack_pool_slice(int slice)
+{
+    struct unpack_task task = {
+        .raw_data = g_pool.raw_data,
+        .output_data = g_pool.output_data,
+        .start_offset = (size_t)slice * g_pool.slice_size,
+        .end_offset = (slice == g_pool.num_slices - 1)
+                          ? g_pool.raw_size
+                          : (size_t)(slice + 1) * g_pool.slice_size,
+        .thread_id = slice
+    };
+    unpack_worker_thread(&task);
+}
+
+/**
+ * @brief 线程池工作线程主体
+ */
+#ifdef _WIN32
+static unsigned int __stdcall pool_worker_main(void *arg) {
+#else
+static void* pool_worker_main(void *arg) {
+#endif
+    (void)arg;
+
+    pool_lock();
+    while (!g_pool.shutdown) {
+        if (g_pool.next_slice >= g_pool.num_slices) {
+            pool_wait_work();
+            continue;
+        }
+
+        int slice = g_pool.next_slice++;
+        pool_unlock();
+
+        unpack_pool_slice(slice);
+
+        pool_lock();
+        g_pool.slices_done++;
+        if (g_pool.slices_done == g_pool.num_slices) {
+            pool_wake_done();
+        }
+    }
+    pool_unlock();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief 创建指定线程数的常驻解包线程池
+ *
+ * 单核机器或workers为1时不创建线程，解包全部走调用线程。
+ *
+ * @param workers 工作线程数，0或负数表示按CPU核心数自动选择
+ */
+void unpack_pool_init_n(int workers)
+{
+    if (workers <= 0) {
+        workers = get_cpu_cores();
+    }
+    if (workers > MAX_POOL_WORKERS) {
+        workers = MAX_POOL_WORKERS;
+    }
+    if (workers <= 1) {
+        return;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_pool.lock);
+    InitializeConditionVariable(&g_pool.work_cv);
+    InitializeConditionVariable(&g_pool.done_cv);
+#else
+    pthread_mutex_init(&g_pool.lock, NULL);
+    pthread_cond_init(&g_pool.work_cv, NULL);
+    pthread_cond_init(&g_pool.done_cv, NULL);
+#endif
+
+    for (int i = 0; i < workers; i++) {
+#ifdef _WIN32
+        g_pool.threads[i] =
+            (HANDLE)_beginthreadex(NULL, 0, pool_worker_main, NULL, 0, NULL);
+        if (g_pool.threads[i] == 0) {
+            break;
+        }
+#else
+        if (pthread_create(&g_pool.threads[i], NULL, pool_worker_main, NULL)
+                != 0) {
+            break;
+        }
+#ifdef __linux__
+        // 多NUMA节点时把解包线程固定在接收线程所在节点上
+        numa_pin_thread(g_pool.threads[i]);
+#endif
+#endif
+        g_pool.num_workers++;
+    }
+
+    printf("Unpack thread pool: %d persistent workers\n", g_pool.num_workers);
+}
+
+/**
+ * @brief 创建常驻解包线程池（按CPU核心数）
+ */
+void unpack_pool_init(void)
+{
+    unpack_pool_init_n(0);
+}
+
+/**
+ * @brief 关闭线程池并回收工作线程
+ */
+void unpack_pool_destroy(void)
+{
+    if (g_pool.num_workers == 0) {
+        return;
+    }
+
+    pool_lock();
+    g_pool.shutdown = 1;
+    pool_wake_workers();
+    pool_unlock();
+
+    for (int i = 0; i < g_pool.num_workers; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(g_pool.threads[i], INFINITE);
+        CloseHandle(g_pool.threads[i]);
+#else
+        pthread_join(g_pool.threads[i], NULL);
+#endif
+    }
+
+#ifdef _WIN32
+    DeleteCriticalSection(&g_pool.lock);
+#else
+    pthread_mutex_destroy(&g_pool.lock);
+    pthread_cond_destroy(&g_pool.work_cv);
+    pthread_cond_destroy(&g_pool.done_cv);
+#endif
+
+    g_pool.num_workers = 0;
+    g_pool.shutdown = 0;
+    printf("Unpack thread pool destroyed\n");
+}
+
+/**
+ * @brief 提交一帧解包任务并等待完成
+ *
+ * 线程池未启用时调用方应走单线程路径，本函数不做检查。
+ *
+ * @param raw_data 输入RAW数据
+ * @param raw_size 输入大小（5的倍数）
+ * @param output 输出像素缓冲区
+ * @param slices 切片数
+ */
+void unpack_pool_run(const uint8_t *raw_data, size_t raw_size,
+                     uint16_t *output, int slices)
+{
+    pool_lock();
+    g_pool.raw_data = raw_data;
+    g_pool.output_data = output;
+    g_pool.raw_size = raw_size;
+    g_pool.slice_size = (raw_size / slices / 5) * 5;
+    g_pool.num_slices = slices;
+    g_pool.next_slice = 0;
+    g_pool.slices_done = 0;
+    pool_wake_workers();
+
+    while (g_pool.slices_done < g_pool.num_slices) {
+        pool_wait_done();
+    }
+
+    // 防止已结束任务的切片计数被误当作新任务
+    g_pool.num_slices = 0;
+    g_pool.next_slice = 0;
+    pool_unlock();
+}
+
+/**
+ * @brief 多线程SBGGR10图像数据解包主函数
+ */
+int unpack_sbggr10_image(const uint8_t *raw_data, size_t raw_size, 
+                        uint16_t *output_pixels, size_t num_pixels) {
+    if (!raw_data || !output_pixels || raw_size == 0) {
+        return -1;
+    }
+    
+    // 验证数据大小（必须是5的倍数）
+    if (raw_size % 5 != 0) {
+        printf("Error: RAW data size (%zu) must be multiple of 5\n", raw_size);
+        return -1;
+    }
+    
+    size_t expected_pixels = raw_size / 5 * 4;
+    if (num_pixels < expected_pixels) {
+        printf("Error: Output buffer too small (%zu < %zu)\n", num_pixels, expected_pixels);
+        return -1;
+    }
     
+    // 小帧或无线程池时在调用线程直接解包，避免任何池开销
+    if (raw_size < MIN_CHUNK_SIZE || g_pool.num_workers <= 1) {
+        struct unpack_task task = {
+            .raw_data = raw_data,
+            .output_data = output_pixels,
+            .start_offset = 0,
+            .end_offset = raw_size,
+            .thread_id = 0
+        };
+        unpack_worker_thread(&task);
+        return 0;
+    }
+
     uint64_t start_time = get_time_ns();
+
+    // 提交给常驻线程池，按工作线程数静态切分
+    unpack_pool_run(raw_data, raw_size, output_pixels, g_pool.num_workers);
+
+    uint64_t end_time = get_time_ns();
+    double elapsed_ms = (end_time - start_time) / 1000000.0;
+    double throughput = (raw_size / 1024.0 / 1024.0) / (elapsed_ms / 1000.0);
     
-    // 创建工作线程
-    for (int i = 0; i < num_threads; i++) {
-        tasks[i].raw_data = raw_data;
-        tasks[i].output_data = output_pixels;
-        tasks[i].start_offset = i * chunk_size;
-        tasks[i].end_offset = (i == num_threads - 1) ? raw_size : (i + 1) * chunk_size;
-        tasks[i].thread_id = i;
-        
-#ifdef _WIN32
-        threads[i] = (HANDLE)_beginthreadex(NULL, 0, unpack_worker_thread, &tasks[i], 0, NULL);
-        if (threads[i] == 0) {
-            return -1;
+    static int call_count = 0;
+    call_count++;
+    if (call_count <= 3 || call_count % 50 == 0) {
+        printf("SBGGR10 unpacking: %.1f ms, %.1f MB/s\n", elapsed_ms, throughput);
+    }
+    
+    return 0;
+}
+
+// ========================== BGGR去马赛克 ==========================
+
+/**
+ * @brief 单像素双线性去马赛克（边界与标量回退共用）
+ *
+ * BGGR排列：偶行为B G B G...，奇行为G R G R...。缺失的颜色
+ * 分量取水平/垂直/对角邻居的均值，xl/xr已做镜像钳制。
+ */
+static inline void debayer_pixel(const uint16_t* up, const uint16_t* cur,
+                                 const uint16_t* dn, uint8_t* out,
+                                 uint32_t x, uint32_t xl, uint32_t xr,
+                                 int odd_row)
+{
+    uint16_t h = (uint16_t)((cur[xl] + cur[xr] + 1) >> 1);
+    uint16_t v = (uint16_t)((up[x] + dn[x] + 1) >> 1);
+    uint16_t p = (uint16_t)((h + v + 1) >> 1);
+    uint16_t d = (uint16_t)((((up[xl] + up[xr] + 1) >> 1) +
+                             ((dn[xl] + dn[xr] + 1) >> 1) + 1) >> 1);
+    uint16_t r16, g16, b16;
+
+    if (!odd_row) {
+        if (!(x & 1)) { r16 = d; g16 = p; b16 = cur[x]; }      // B像素
+        else          { r16 = v; g16 = cur[x]; b16 = h; }      // B行G像素
+    } else {
+        if (!(x & 1)) { r16 = h; g16 = cur[x]; b16 = v; }      // R行G像素
+        else          { r16 = cur[x]; g16 = p; b16 = d; }      // R像素
+    }
+
+    // 10位降到8位
+    out[0] = (uint8_t)(r16 >> 2);
+    out[1] = (uint8_t)(g16 >> 2);
+    out[2] = (uint8_t)(b16 >> 2);
+}
+
+/**
+ * @brief 去马赛克行内核（标量版本）
+ */
+void debayer_row_scalar(const uint16_t* up, const uint16_t* cur,
+                        const uint16_t* dn, uint8_t* rgb,
+                        uint32_t width, int odd_row)
+{
+    for (uint32_t x = 0; x < width; x++) {
+        uint32_t xl = x ? x - 1 : 1;
+        uint32_t xr = (x + 1 < width) ? x + 1 : width - 2;
+        debayer_pixel(up, cur, dn, rgb + (size_t)x * 3, x, xl, xr, odd_row);
+    }
+}
+
+#ifdef UNPACK_ARCH_X86
+
+/**
+ * @brief 去马赛克行内核（AVX2版本）
+ *
+ * 每次处理16个像素：avg_epu16算出水平/垂直/对角均值，再按
+ * 列奇偶用blend_epi16（0xAA，每128位通道内交替选取）组装出
+ * R/G/B三个16位向量。向量循环从x=2开始且步长为16，列奇偶
+ * 相位保持不变，blend掩码对整行都成立。RGB交织部分是纯字节
+ * 搬运，标量即可跟上。
+ */
+UNPACK_TARGET("avx2")
+void debayer_row_avx2(const uint16_t* up, const uint16_t* cur,
+                      const uint16_t* dn, uint8_t* rgb,
+                      uint32_t width, int odd_row)
+{
+    uint32_t x = 0;
+
+    // 左边界两列走标量（镜像钳制）
+    for (; x < 2 && x < width; x++) {
+        uint32_t xl = x ? x - 1 : 1;
+        uint32_t xr = (x + 1 < width) ? x + 1 : width - 2;
+        debayer_pixel(up, cur, dn, rgb + (size_t)x * 3, x, xl, xr, odd_row);
+    }
+
+    for (; x + 16 <= width - 1; x += 16) {
+        __m256i c  = _mm256_loadu_si256((const __m256i*)(cur + x));
+        __m256i cl = _mm256_loadu_si256((const __m256i*)(cur + x - 1));
+        __m256i cr = _mm256_loadu_si256((const __m256i*)(cur + x + 1));
+        __m256i u  = _mm256_loadu_si256((const __m256i*)(up + x));
+        __m256i dw = _mm256_loadu_si256((const __m256i*)(dn + x));
+        __m256i ul = _mm256_loadu_si256((const __m256i*)(up + x - 1));
+        __m256i ur = _mm256_loadu_si256((const __m256i*)(up + x + 1));
+        __m256i dl = _mm256_loadu_si256((const __m256i*)(dn + x - 1));
+        __m256i dr = _mm256_loadu_si256((const __m256i*)(dn + x + 1));
+
+        __m256i h = _mm256_avg_epu16(cl, cr);
+        __m256i v = _mm256_avg_epu16(u, dw);
+        __m256i p = _mm256_avg_epu16(h, v);
+        __m256i d = _mm256_avg_epu16(_mm256_avg_epu16(ul, ur),
+                                     _mm256_avg_epu16(dl, dr));
+
+        __m256i r16, g16, b16;
+        if (!odd_row) {
+            r16 = _mm256_blend_epi16(d, v, 0xAA);
+            g16 = _mm256_blend_epi16(p, c, 0xAA);
+            b16 = _mm256_blend_epi16(c, h, 0xAA);
+        } else {
+            r16 = _mm256_blend_epi16(h, c, 0xAA);
+            g16 = _mm256_blend_epi16(c, p, 0xAA);
+            b16 = _mm256_blend_epi16(v, d, 0xAA);
+        }
+
+        r16 = _mm256_srli_epi16(r16, 2);
+        g16 = _mm256_srli_epi16(g16, 2);
+        b16 = _mm256_srli_epi16(b16, 2);
+
+        __m128i r8 = _mm_packus_epi16(_mm256_castsi256_si128(r16),
+                                      _mm256_extracti128_si256(r16, 1));
+        __m128i g8 = _mm_packus_epi16(_mm256_castsi256_si128(g16),
+                                      _mm256_extracti128_si256(g16, 1));
+        __m128i b8 = _mm_packus_epi16(_mm256_castsi256_si128(b16),
+                                      _mm256_extracti128_si256(b16, 1));
+
+        uint8_t rt[16], gt[16], bt[16];
+        _mm_storeu_si128((__m128i*)rt, r8);
+        _mm_storeu_si128((__m128i*)gt, g8);
+        _mm_storeu_si128((__m128i*)bt, b8);
+
+        uint8_t* o = rgb + (size_t)x * 3;
+        for (int k = 0; k < 16; k++) {
+            o[k * 3 + 0] = rt[k];
+            o[k * 3 + 1] = gt[k];
+            o[k * 3 + 2] = bt[k];
+        }
+    }
+
+    // 右边界余量走标量
+    for (; x < width; x++) {
+        uint32_t xl = x - 1;
+        uint32_t xr = (x + 1 < width) ? x + 1 : width - 2;
+        debayer_pixel(up, cur, dn, rgb + (size_t)x * 3, x, xl, xr, odd_row);
+    }
+}
+
+#endif  // UNPACK_ARCH_X86
+
+#ifdef UNPACK_ARCH_NEON
+
+/**
+ * @brief 去马赛克行内核（NEON版本）
+ *
+ * 每次处理8个像素，vrhaddq_u16做带舍入均值，vbslq_u16按列
+ * 奇偶掩码组装，vst3_u8直接交织写出RGB三通道。
+ */
+void debayer_row_neon(const uint16_t* up, const uint16_t* cur,
+                      const uint16_t* dn, uint8_t* rgb,
+                      uint32_t width, int odd_row)
+{
+    static const uint16_t odd_lanes[8] = {0, 0xFFFF, 0, 0xFFFF,
+                                          0, 0xFFFF, 0, 0xFFFF};
+    uint16x8_t odd_mask = vld1q_u16(odd_lanes);
+    uint32_t x = 0;
+
+    for (; x < 2 && x < width; x++) {
+        uint32_t xl = x ? x - 1 : 1;
+        uint32_t xr = (x + 1 < width) ? x + 1 : width - 2;
+        debayer_pixel(up, cur, dn, rgb + (size_t)x * 3, x, xl, xr, odd_row);
+    }
+
+    for (; x + 8 <= width - 1; x += 8) {
+        uint16x8_t c  = vld1q_u16(cur + x);
+        uint16x8_t h  = vrhaddq_u16(vld1q_u16(cur + x - 1),
+                                    vld1q_u16(cur + x + 1));
+        uint16x8_t v  = vrhaddq_u16(vld1q_u16(up + x), vld1q_u16(dn + x));
+        uint16x8_t p  = vrhaddq_u16(h, v);
+        uint16x8_t d  = vrhaddq_u16(
+            vrhaddq_u16(vld1q_u16(up + x - 1), vld1q_u16(up + x + 1)),
+            vrhaddq_u16(vld1q_u16(dn + x - 1), vld1q_u16(dn + x + 1)));
+
+        uint16x8_t r16, g16, b16;
+        if (!odd_row) {
+            r16 = vbslq_u16(odd_mask, v, d);
+            g16 = vbslq_u16(odd_mask, c, p);
+            b16 = vbslq_u16(odd_mask, h, c);
+        } else {
+            r16 = vbslq_u16(odd_mask, c, h);
+            g16 = vbslq_u16(odd_mask, p, c);
+            b16 = vbslq_u16(odd_mask, d, v);
+        }
+
+        uint8x8x3_t out;
+        out.val[0] = vshrn_n_u16(r16, 2);
+        out.val[1] = vshrn_n_u16(g16, 2);
+        out.val[2] = vshrn_n_u16(b16, 2);
+        vst3_u8(rgb + (size_t)x * 3, out);
+    }
+
+    for (; x < width; x++) {
+        uint32_t xl = x - 1;
+        uint32_t xr = (x + 1 < width) ? x + 1 : width - 2;
+        debayer_pixel(up, cur, dn, rgb + (size_t)x * 3, x, xl, xr, odd_row);
+    }
+}
+
+#endif  // UNPACK_ARCH_NEON
+
+/** @brief 当前去马赛克行内核（select_unpack_kernel中按CPU特性切换） */
+debayer_row_fn g_debayer_row = debayer_row_scalar;
+
+/**
+ * @brief 16位BGGR Bayer图像去马赛克为RGB888
+ *
+ * 逐行调用当前行内核；上下边界行用相邻行镜像。输入为
+ * unpack_sbggr10_image输出的10位有效值（存于16位）。
+ *
+ * @return 成功返回0，尺寸非法返回-1
+ */
+int debayer_bggr10_to_rgb888(const uint16_t* bayer, uint8_t* rgb,
+                             uint32_t width, uint32_t height)
+{
+    if (width < 4 || height < 2 || (width & 1) || (height & 1)) {
+        return -1;
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint16_t* cur = bayer + (size_t)y * width;
+        const uint16_t* up = (y == 0) ? cur + width : cur - width;
+        const uint16_t* dn = (y + 1 == height) ? cur - width : cur + width;
+        g_debayer_row(up, cur, dn, rgb + (size_t)y * width * 3, width,
+                      (int)(y & 1));
+    }
+
+    return 0;
+}
+
+// ========================== 异步落盘队列 ==========================
+
+/** @brief 写回队列深度 */
+#define WRITEQ_DEPTH 16
+
+/**
+ * @struct write_job
+ * @brief 单个异步写任务
+ */
+struct write_job {
+    char filename[MAX_FILENAME_LEN]; /**< 目标文件路径 */
+    uint8_t* data;                   /**< 待写数据（队列持有所有权） */
+    size_t size;                     /**< 数据大小 */
+};
+
+/**
+ * @struct write_queue
+ * @brief 有界异步写回队列
+ *
+ * 接收路径只负责把(文件名,数据)入队即返回，常驻写线程在
+ * 后台排空——慢速磁盘或网络共享的单次写入不再反压socket。
+ * 队列满时默认阻塞入队（保证不丢保存），--drop-saves策略
+ * 下改为丢弃该次保存以保护内存与接收实时性。
+ */
+struct write_queue {
+    struct write_job jobs[WRITEQ_DEPTH]; /**< 任务槽位环 */
+    int head;     /**< 下一个待写任务索引 */
+    int count;    /**< 排队中的任务数 */
+    int started;  /**< 写线程是否已启动 */
+    int shutdown; /**< 关闭标志 */
+    int drop_on_full; /**< 队列满策略：1=丢弃保存，0=阻塞 */
+
+    uint64_t writes_done;    /**< 完成的写入次数 */
+    uint64_t bytes_written;  /**< 完成的写入字节数 */
+    uint64_t write_drops;    /**< 因队列满丢弃的保存次数 */
+    uint64_t total_write_ns; /**< 写入耗时累计，纳秒 */
+    uint64_t max_write_ns;   /**< 单次写入最大耗时，纳秒 */
+    int peak_depth;          /**< 队列深度峰值 */
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE not_empty;
+    CONDITION_VARIABLE not_full;
+    HANDLE thread;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+#endif
+};
+
+/** @brief 全局写回队列 */
+static struct write_queue g_wq;
+
+#ifdef _WIN32
+#define wq_lock()           EnterCriticalSection(&g_wq.lock)
+#define wq_unlock()         LeaveCriticalSection(&g_wq.lock)
+#define wq_wait_not_empty() SleepConditionVariableCS(&g_wq.not_empty, &g_wq.lock, INFINITE)
+#define wq_wait_not_full()  SleepConditionVariableCS(&g_wq.not_full, &g_wq.lock, INFINITE)
+#define wq_wake_not_empty() WakeConditionVariable(&g_wq.not_empty)
+#define wq_wake_not_full()  WakeConditionVariable(&g_wq.not_full)
+#else
+#define wq_lock()           pthread_mutex_lock(&g_wq.lock)
+#define wq_unlock()         pthread_mutex_unlock(&g_wq.lock)
+#define wq_wait_not_empty() pthread_cond_wait(&g_wq.not_empty, &g_wq.lock)
+#define wq_wait_not_full()  pthread_cond_wait(&g_wq.not_full, &g_wq.lock)
+#define wq_wake_not_empty() pthread_cond_signal(&g_wq.not_empty)
+#define wq_wake_not_full()  pthread_cond_signal(&g_wq.not_full)
+#endif
+
+// ========================== io_uring写盘后端 ==========================
+
+static int write_file_sync(const char* filename, const uint8_t* data,
+                           size_t size);
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+/** @brief io_uring后端同时在途的写入数 */
+#define URING_INFLIGHT 8
+
+/**
+ * @struct uring_write
+ * @brief 一次在途的异步写入
+ */
+struct uring_write {
+    int fd;          /**< 目标文件描述符 */
+    uint8_t* data;   /**< 待写数据（完成后释放） */
+    size_t size;     /**< 总字节数 */
+    size_t done;     /**< 已完成字节数（短写续传用） */
+    uint64_t start_ns; /**< 提交时刻，用于写入耗时统计 */
+    int in_use;      /**< 槽位占用标志 */
+    char filename[MAX_FILENAME_LEN]; /**< 文件路径（出错提示用） */
+};
+
+/**
+ * @struct uring_backend
+ * @brief io_uring写盘后端状态
+ *
+ * 用裸系统调用驱动io_uring，不引入liburing依赖。写线程是
+ * 唯一的提交者与收割者，环上无并发，省去所有内部锁。
+ * 同一批最多URING_INFLIGHT个文件的写入在内核中并行推进，
+ * 写线程不再被单次write()系统调用阻塞。
+ */
+struct uring_backend {
+    int ring_fd;               /**< io_uring实例fd */
+    unsigned* sq_head;         /**< 提交队列头指针（内核消费） */
+    unsigned* sq_tail;         /**< 提交队列尾指针（用户推进） */
+    unsigned* sq_mask;         /**< 提交队列索引掩码 */
+    unsigned* sq_array;        /**< 提交队列索引数组 */
+    unsigned* cq_head;         /**< 完成队列头指针（用户推进） */
+    unsigned* cq_tail;         /**< 完成队列尾指针（内核推进） */
+    unsigned* cq_mask;         /**< 完成队列索引掩码 */
+    struct io_uring_sqe* sqes; /**< 提交项数组 */
+    struct io_uring_cqe* cqes; /**< 完成项数组 */
+    void* sq_ring_ptr;         /**< 提交环映射基址 */
+    void* cq_ring_ptr;         /**< 完成环映射基址 */
+    size_t sq_ring_sz;         /**< 提交环映射大小 */
+    size_t cq_ring_sz;         /**< 完成环映射大小 */
+    struct uring_write writes[URING_INFLIGHT]; /**< 在途写入槽位 */
+    int inflight;              /**< 在途写入数（仅写线程访问） */
+};
+
+/** @brief 全局io_uring后端 */
+static struct uring_backend g_uring;
+
+/** @brief io_uring是否可用（writeback_init()中探测） */
+static int g_uring_available = 0;
+
+/**
+ * @brief 创建io_uring实例并映射队列环
+ *
+ * 内核过旧或被seccomp拦截时返回失败，写线程回退到同步写。
+ * 建环成功后还会用一次真实写入探测IORING_OP_WRITE支持，
+ * 排除io_uring_setup成功但写操作不可用的内核（5.1~5.5）。
+ *
+ * @return 成功返回0，失败返回-1
+ */
+static int uring_init(void)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(&g_uring, 0, sizeof(g_uring));
+
+    int fd = (int)syscall(__NR_io_uring_setup, URING_INFLIGHT * 2, &params);
+    if (fd < 0) {
+        return -1;
+    }
+
+    g_uring.sq_ring_sz = params.sq_off.array +
+                         params.sq_entries * sizeof(unsigned);
+    g_uring.cq_ring_sz = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // 新内核把两个环放进同一块映射
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (g_uring.cq_ring_sz > g_uring.sq_ring_sz) {
+            g_uring.sq_ring_sz = g_uring.cq_ring_sz;
+        }
+    }
+
+    g_uring.sq_ring_ptr = mmap(NULL, g_uring.sq_ring_sz,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, fd,
+                               IORING_OFF_SQ_RING);
+    if (g_uring.sq_ring_ptr == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        g_uring.cq_ring_ptr = g_uring.sq_ring_ptr;
+    } else {
+        g_uring.cq_ring_ptr = mmap(NULL, g_uring.cq_ring_sz,
+                                   PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd,
+                                   IORING_OFF_CQ_RING);
+        if (g_uring.cq_ring_ptr == MAP_FAILED) {
+            munmap(g_uring.sq_ring_ptr, g_uring.sq_ring_sz);
+            close(fd);
+            return -1;
+        }
+    }
+
+    g_uring.sqes = (struct io_uring_sqe*)
+        mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+             IORING_OFF_SQES);
+    if (g_uring.sqes == MAP_FAILED) {
+        if (g_uring.cq_ring_ptr != g_uring.sq_ring_ptr) {
+            munmap(g_uring.cq_ring_ptr, g_uring.cq_ring_sz);
+        }
+        munmap(g_uring.sq_ring_ptr, g_uring.sq_ring_sz);
+        close(fd);
+        return -1;
+    }
+
+    uint8_t* sq = (uint8_t*)g_uring.sq_ring_ptr;
+    uint8_t* cq = (uint8_t*)g_uring.cq_ring_ptr;
+    g_uring.sq_head  = (unsigned*)(sq + params.sq_off.head);
+    g_uring.sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+    g_uring.sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    g_uring.sq_array = (unsigned*)(sq + params.sq_off.array);
+    g_uring.cq_head  = (unsigned*)(cq + params.cq_off.head);
+    g_uring.cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+    g_uring.cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    g_uring.cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    g_uring.ring_fd  = fd;
+
+    // 探测IORING_OP_WRITE支持：io_uring_setup自5.1就能成功，但
+    // 写操作要到5.6才有，老内核上所有提交都会以-EINVAL完成。
+    // 向/dev/null发一次真实写入并检查完成结果。
+    int probe_res = -EINVAL;
+    int nullfd = open("/dev/null", O_WRONLY);
+    if (nullfd >= 0) {
+        uint8_t probe_byte = 0;
+        unsigned tail = *g_uring.sq_tail;
+        unsigned idx  = tail & *g_uring.sq_mask;
+
+        struct io_uring_sqe* sqe = &g_uring.sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd     = nullfd;
+        sqe->addr   = (uint64_t)(uintptr_t)&probe_byte;
+        sqe->len    = 1;
+
+        g_uring.sq_array[idx] = idx;
+        __atomic_store_n(g_uring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        if (syscall(__NR_io_uring_enter, g_uring.ring_fd, 1, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) >= 0) {
+            unsigned chead = __atomic_load_n(g_uring.cq_head,
+                                             __ATOMIC_ACQUIRE);
+            if (chead != __atomic_load_n(g_uring.cq_tail,
+                                         __ATOMIC_ACQUIRE)) {
+                probe_res = g_uring.cqes[chead & *g_uring.cq_mask].res;
+                __atomic_store_n(g_uring.cq_head, chead + 1,
+                                 __ATOMIC_RELEASE);
+            }
+        }
+        close(nullfd);
+    }
+
+    if (probe_res != 1) {
+        printf("io_uring lacks IORING_OP_WRITE (kernel < 5.6), "
+               "using sync writes\n");
+        munmap(g_uring.sqes,
+               (*g_uring.sq_mask + 1) * sizeof(struct io_uring_sqe));
+        if (g_uring.cq_ring_ptr != g_uring.sq_ring_ptr) {
+            munmap(g_uring.cq_ring_ptr, g_uring.cq_ring_sz);
+        }
+        munmap(g_uring.sq_ring_ptr, g_uring.sq_ring_sz);
+        close(fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 销毁io_uring实例，解除队列环映射
+ */
+static void uring_destroy(void)
+{
+    if (!g_uring_available) {
+        return;
+    }
+
+    munmap(g_uring.sqes,
+           (*g_uring.sq_mask + 1) * sizeof(struct io_uring_sqe));
+    if (g_uring.cq_ring_ptr != g_uring.sq_ring_ptr) {
+        munmap(g_uring.cq_ring_ptr, g_uring.cq_ring_sz);
+    }
+    munmap(g_uring.sq_ring_ptr, g_uring.sq_ring_sz);
+    close(g_uring.ring_fd);
+    g_uring_available = 0;
+}
+
+/**
+ * @brief 提交（或续传）一个写入SQE
+ *
+ * @param w 在途写入槽位
+ * @return 成功返回0，io_uring_enter失败返回-1
+ */
+static int uring_submit_write(struct uring_write* w)
+{
+    unsigned tail = *g_uring.sq_tail;
+    unsigned idx  = tail & *g_uring.sq_mask;
+
+    struct io_uring_sqe* sqe = &g_uring.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_WRITE;
+    sqe->fd        = w->fd;
+    sqe->addr      = (uint64_t)(uintptr_t)(w->data + w->done);
+    sqe->len       = (uint32_t)(w->size - w->done);
+    sqe->off       = w->done;
+    sqe->user_data = (uint64_t)(w - g_uring.writes);
+
+    g_uring.sq_array[idx] = idx;
+    __atomic_store_n(g_uring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (syscall(__NR_io_uring_enter, g_uring.ring_fd, 1, 0, 0, NULL, 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 完成一个在途写入：关闭文件、累计统计、释放槽位
+ */
+static void uring_complete(struct uring_write* w, int success)
+{
+    uint64_t elapsed = get_time_ns() - w->start_ns;
+
+    close(w->fd);
+    free(w->data);
+    w->in_use = 0;
+    g_uring.inflight--;
+
+    if (success) {
+        wq_lock();
+        g_wq.writes_done++;
+        g_wq.bytes_written += w->size;
+        g_wq.total_write_ns += elapsed;
+        if (elapsed > g_wq.max_write_ns) {
+            g_wq.max_write_ns = elapsed;
+        }
+        wq_unlock();
+    }
+}
+
+/**
+ * @brief 收割完成事件，短写自动续传
+ *
+ * 完成结果为错误时不丢弃任务：槽位中的数据与fd仍然有效，
+ * 改用同步pwrite写完剩余部分再释放，保证保存不丢失。
+ *
+ * @param wait 非0时在完成队列为空的情况下阻塞等待至少一个完成
+ */
+static void uring_reap(int wait)
+{
+    unsigned head = __atomic_load_n(g_uring.cq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = __atomic_load_n(g_uring.cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail && wait) {
+        syscall(__NR_io_uring_enter, g_uring.ring_fd, 0, 1,
+                IORING_ENTER_GETEVENTS, NULL, 0);
+        tail = __atomic_load_n(g_uring.cq_tail, __ATOMIC_ACQUIRE);
+    }
+
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &g_uring.cqes[head & *g_uring.cq_mask];
+        struct uring_write* w = &g_uring.writes[cqe->user_data];
+        int res = cqe->res;
+
+        head++;
+        __atomic_store_n(g_uring.cq_head, head, __ATOMIC_RELEASE);
+
+        if (res > 0 && w->done + (size_t)res < w->size) {
+            // 短写：从断点续传剩余部分
+            w->done += (size_t)res;
+            if (uring_submit_write(w) == 0) {
+                continue;
+            }
+            res = -EIO;
+        }
+
+        if (res > 0) {
+            uring_complete(w, 1);
+            continue;
+        }
+
+        // 完成出错：数据与fd仍在槽位里，退回同步写保证任务完成
+        while (w->done < w->size) {
+            ssize_t n = pwrite(w->fd, w->data + w->done,
+                               w->size - w->done, (off_t)w->done);
+            if (n <= 0) {
+                break;
+            }
+            w->done += (size_t)n;
+        }
+
+        if (w->done == w->size) {
+            uring_complete(w, 1);
+        } else {
+            printf("Async write failed: %s (%s)\n",
+                   w->filename, strerror(res < 0 ? -res : EIO));
+            uring_complete(w, 0);
+        }
+    }
+}
+
+/**
+ * @brief 打开目标文件并发起异步写入
+ *
+ * 打开或提交失败时回退为同步写，任务不丢失。
+ *
+ * @param job 出队的写任务（本函数接管data所有权）
+ */
+static void uring_start_write(struct write_job* job)
+{
+    int fd = open(job->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Failed to open output file: %s\n", job->filename);
+        free(job->data);
+        return;
+    }
+
+    struct uring_write* w = NULL;
+    for (int i = 0; i < URING_INFLIGHT; i++) {
+        if (!g_uring.writes[i].in_use) {
+            w = &g_uring.writes[i];
+            break;
+        }
+    }
+
+    w->fd = fd;
+    w->data = job->data;
+    w->size = job->size;
+    w->done = 0;
+    w->start_ns = get_time_ns();
+    w->in_use = 1;
+    snprintf(w->filename, MAX_FILENAME_LEN, "%s", job->filename);
+
+    if (uring_submit_write(w) < 0) {
+        // 提交失败：退回同步写，保证任务完成
+        uint64_t t0 = get_time_ns();
+        size_t off = 0;
+        while (off < w->size) {
+            ssize_t n = write(fd, w->data + off, w->size - off);
+            if (n <= 0) {
+                printf("Failed to write output file: %s\n", w->filename);
+                break;
+            }
+            off += (size_t)n;
+        }
+        uint64_t elapsed = get_time_ns() - t0;
+
+        close(fd);
+        free(w->data);
+        w->in_use = 0;
+
+        if (off == w->size) {
+            wq_lock();
+            g_wq.writes_done++;
+            g_wq.bytes_written += w->size;
+            g_wq.total_write_ns += elapsed;
+            if (elapsed > g_wq.max_write_ns) {
+                g_wq.max_write_ns = elapsed;
+            }
+            wq_unlock();
+        }
+        return;
+    }
+
+    g_uring.inflight++;
+}
+
+/**
+ * @brief io_uring写回主循环
+ *
+ * 优先吃满在途窗口：队列有任务且窗口未满时持续出队提交，
+ * 窗口满或队列空时收割完成事件。退出条件为收到关闭标志、
+ * 队列排空且所有在途写入均已落盘。
+ */
+static void writeback_main_uring(void)
+{
+    for (;;) {
+        struct write_job job;
+        int have_job = 0;
+        int should_exit = 0;
+
+        wq_lock();
+        while (g_wq.count == 0 && !g_wq.shutdown && g_uring.inflight == 0) {
+            wq_wait_not_empty();
+        }
+        if (g_wq.count > 0 && g_uring.inflight < URING_INFLIGHT) {
+            job = g_wq.jobs[g_wq.head];
+            g_wq.head = (g_wq.head + 1) % WRITEQ_DEPTH;
+            g_wq.count--;
+            have_job = 1;
+            wq_wake_not_full();
+        } else if (g_wq.count == 0 && g_wq.shutdown &&
+                   g_uring.inflight == 0) {
+            should_exit = 1;
+        }
+        wq_unlock();
+
+        if (should_exit) {
+            break;
+        }
+
+        if (have_job) {
+            uring_start_write(&job);
+            continue;
+        }
+
+        uring_reap(1);
+    }
+}
+
+#endif // HAVE_IO_URING
+
+#ifdef _WIN32
+
+/** @brief overlapped后端同时在途的写入数 */
+#define OVERLAPPED_INFLIGHT 8
+
+/**
+ * @struct overlapped_write
+ * @brief 一次在途的overlapped写入
+ */
+struct overlapped_write {
+    HANDLE file;       /**< 目标文件句柄 */
+    OVERLAPPED ov;     /**< overlapped控制块（hEvent用于收割） */
+    uint8_t* data;     /**< 待写数据（完成后释放） */
+    size_t size;       /**< 总字节数 */
+    size_t done;       /**< 已完成字节数 */
+    uint64_t start_ns; /**< 提交时刻 */
+    int in_use;        /**< 槽位占用标志 */
+    char filename[MAX_FILENAME_LEN]; /**< 文件路径（出错提示用） */
+};
+
+/** @brief overlapped在途写入槽位 */
+static struct overlapped_write g_ov_writes[OVERLAPPED_INFLIGHT];
+
+/** @brief overlapped在途写入数（仅写线程访问） */
+static int g_ov_inflight = 0;
+
+/**
+ * @brief 完成一个overlapped写入：关闭句柄、累计统计、释放槽位
+ */
+static void overlapped_complete(struct overlapped_write* w, int success)
+{
+    uint64_t elapsed = get_time_ns() - w->start_ns;
+
+    CloseHandle(w->file);
+    CloseHandle(w->ov.hEvent);
+    free(w->data);
+    w->in_use = 0;
+    g_ov_inflight--;
+
+    if (success) {
+        wq_lock();
+        g_wq.writes_done++;
+        g_wq.bytes_written += w->size;
+        g_wq.total_write_ns += elapsed;
+        if (elapsed > g_wq.max_write_ns) {
+            g_wq.max_write_ns = elapsed;
+        }
+        wq_unlock();
+    }
+}
+
+/**
+ * @brief 从当前断点发起（或续传）一次overlapped写入
+ *
+ * @return 成功（在途或同步完成）返回0，失败返回-1
+ */
+static int overlapped_issue(struct overlapped_write* w)
+{
+    w->ov.Offset     = (DWORD)(w->done & 0xFFFFFFFF);
+    w->ov.OffsetHigh = (DWORD)(w->done >> 32);
+
+    if (!WriteFile(w->file, w->data + w->done,
+                   (DWORD)(w->size - w->done), NULL, &w->ov) &&
+        GetLastError() != ERROR_IO_PENDING) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 收割overlapped完成事件，短写自动续传
+ *
+ * @param wait 非0时阻塞等待至少一个在途写入完成
+ */
+static void overlapped_reap(int wait)
+{
+    HANDLE events[OVERLAPPED_INFLIGHT];
+    int slots[OVERLAPPED_INFLIGHT];
+    int n = 0;
+
+    for (int i = 0; i < OVERLAPPED_INFLIGHT; i++) {
+        if (g_ov_writes[i].in_use) {
+            events[n] = g_ov_writes[i].ov.hEvent;
+            slots[n] = i;
+            n++;
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+
+    DWORD r = WaitForMultipleObjects((DWORD)n, events, FALSE,
+                                     wait ? INFINITE : 0);
+    if (r >= WAIT_OBJECT_0 + (DWORD)n) {
+        return;
+    }
+
+    struct overlapped_write* w = &g_ov_writes[slots[r - WAIT_OBJECT_0]];
+    DWORD transferred = 0;
+
+    if (!GetOverlappedResult(w->file, &w->ov, &transferred, FALSE) ||
+        transferred == 0) {
+        printf("Async write failed: %s (error %lu)\n",
+               w->filename, GetLastError());
+        overlapped_complete(w, 0);
+        return;
+    }
+
+    w->done += transferred;
+    if (w->done < w->size) {
+        // 短写：从断点续传
+        ResetEvent(w->ov.hEvent);
+        if (overlapped_issue(w) < 0) {
+            printf("Async write failed: %s (error %lu)\n",
+                   w->filename, GetLastError());
+            overlapped_complete(w, 0);
+        }
+        return;
+    }
+
+    overlapped_complete(w, 1);
+}
+
+/**
+ * @brief 打开目标文件并发起overlapped写入
+ *
+ * 打开或提交失败时回退为同步写，任务不丢失。
+ */
+static void overlapped_start_write(struct write_job* job)
+{
+    HANDLE file = CreateFileA(job->filename, GENERIC_WRITE, 0, NULL,
+                              CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Failed to open output file: %s\n", job->filename);
+        free(job->data);
+        return;
+    }
+
+    struct overlapped_write* w = NULL;
+    for (int i = 0; i < OVERLAPPED_INFLIGHT; i++) {
+        if (!g_ov_writes[i].in_use) {
+            w = &g_ov_writes[i];
+            break;
+        }
+    }
+
+    memset(&w->ov, 0, sizeof(w->ov));
+    w->ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    w->file = file;
+    w->data = job->data;
+    w->size = job->size;
+    w->done = 0;
+    w->start_ns = get_time_ns();
+    w->in_use = 1;
+    snprintf(w->filename, MAX_FILENAME_LEN, "%s", job->filename);
+
+    if (!w->ov.hEvent || overlapped_issue(w) < 0) {
+        // 提交失败：退回同步写，保证任务完成
+        if (w->ov.hEvent) {
+            CloseHandle(w->ov.hEvent);
+        }
+        CloseHandle(file);
+
+        uint64_t t0 = get_time_ns();
+        if (write_file_sync(w->filename, w->data, w->size) == 0) {
+            uint64_t elapsed = get_time_ns() - t0;
+            wq_lock();
+            g_wq.writes_done++;
+            g_wq.bytes_written += w->size;
+            g_wq.total_write_ns += elapsed;
+            if (elapsed > g_wq.max_write_ns) {
+                g_wq.max_write_ns = elapsed;
+            }
+            wq_unlock();
+        }
+        free(w->data);
+        w->in_use = 0;
+        return;
+    }
+
+    g_ov_inflight++;
+}
+
+/**
+ * @brief overlapped写回主循环（与io_uring循环结构一致）
+ */
+static void writeback_main_overlapped(void)
+{
+    for (;;) {
+        struct write_job job;
+        int have_job = 0;
+        int should_exit = 0;
+
+        wq_lock();
+        while (g_wq.count == 0 && !g_wq.shutdown && g_ov_inflight == 0) {
+            wq_wait_not_empty();
+        }
+        if (g_wq.count > 0 && g_ov_inflight < OVERLAPPED_INFLIGHT) {
+            job = g_wq.jobs[g_wq.head];
+            g_wq.head = (g_wq.head + 1) % WRITEQ_DEPTH;
+            g_wq.count--;
+            have_job = 1;
+            wq_wake_not_full();
+        } else if (g_wq.count == 0 && g_wq.shutdown && g_ov_inflight == 0) {
+            should_exit = 1;
+        }
+        wq_unlock();
+
+        if (should_exit) {
+            break;
+        }
+
+        if (have_job) {
+            overlapped_start_write(&job);
+            continue;
+        }
+
+        overlapped_reap(1);
+    }
+}
+
+#endif // _WIN32
+
+/**
+ * @brief 同步写出一个文件（写线程与无队列回退路径共用）
+ */
+static int write_file_sync(const char* filename, const uint8_t* data,
+                           size_t size)
+{
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        printf("Failed to open output file: %s\n", filename);
+        return -1;
+    }
+
+    size_t written = fwrite(data, 1, size, fp);
+    fclose(fp);
+
+    if (written != size) {
+        printf("Warning: wrote %zu bytes instead of %zu to %s\n",
+               written, size, filename);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 写回线程主体：排空队列并统计每次写入耗时
+ */
+#ifdef _WIN32
+static unsigned int __stdcall writeback_main(void *arg) {
+#else
+static void* writeback_main(void *arg) {
+#endif
+    (void)arg;
+
+#ifdef _WIN32
+    writeback_main_overlapped();
+    return 0;
+#else
+#ifdef HAVE_IO_URING
+    if (g_uring_available) {
+        writeback_main_uring();
+        return NULL;
+    }
+#endif
+
+    wq_lock();
+    for (;;) {
+        while (g_wq.count == 0 && !g_wq.shutdown) {
+            wq_wait_not_empty();
+        }
+        if (g_wq.count == 0 && g_wq.shutdown) {
+            break;
+        }
+
+        struct write_job job = g_wq.jobs[g_wq.head];
+        g_wq.head = (g_wq.head + 1) % WRITEQ_DEPTH;
+        g_wq.count--;
+        wq_wake_not_full();
+        wq_unlock();
+
+        uint64_t t0 = get_time_ns();
+        write_file_sync(job.filename, job.data, job.size);
+        uint64_t elapsed = get_time_ns() - t0;
+        free(job.data);
+
+        wq_lock();
+        g_wq.writes_done++;
+        g_wq.bytes_written += job.size;
+        g_wq.total_write_ns += elapsed;
+        if (elapsed > g_wq.max_write_ns) {
+            g_wq.max_write_ns = elapsed;
+        }
+    }
+    wq_unlock();
+    return NULL;
+#endif // !_WIN32
+}
+
+/**
+ * @brief 启动异步写回队列
+ *
+ * @param drop_on_full 队列满策略：1=丢弃保存，0=阻塞入队
+ */
+void writeback_init(int drop_on_full)
+{
+    memset(&g_wq, 0, sizeof(g_wq));
+    g_wq.drop_on_full = drop_on_full;
+
+    const char* backend = "sync write thread";
+#ifdef HAVE_IO_URING
+    if (uring_init() == 0) {
+        g_uring_available = 1;
+        backend = "io_uring";
+    }
+#endif
+#ifdef _WIN32
+    backend = "overlapped I/O";
+#endif
+
+#ifdef _WIN32
+    InitializeCriticalSection(&g_wq.lock);
+    InitializeConditionVariable(&g_wq.not_empty);
+    InitializeConditionVariable(&g_wq.not_full);
+    g_wq.thread = (HANDLE)_beginthreadex(NULL, 0, writeback_main, NULL, 0, NULL);
+    if (g_wq.thread == 0) {
+        printf("Warning: writeback thread failed, saves will be synchronous\n");
+        return;
+    }
+#else
+    pthread_mutex_init(&g_wq.lock, NULL);
+    pthread_cond_init(&g_wq.not_empty, NULL);
+    pthread_cond_init(&g_wq.not_full, NULL);
+    if (pthread_create(&g_wq.thread, NULL, writeback_main, NULL) != 0) {
+        printf("Warning: writeback thread failed, saves will be synchronous\n");
+        return;
+    }
+#endif
+
+    g_wq.started = 1;
+    printf("Async writeback queue: depth %d, backend: %s, "
+           "on-full policy: %s\n",
+           WRITEQ_DEPTH, backend, drop_on_full ? "drop saves" : "block");
+}
+
+/**
+ * @brief 关闭写回队列，排空剩余任务后回收写线程
+ */
+void writeback_destroy(void)
+{
+    if (!g_wq.started) {
+        return;
+    }
+
+    wq_lock();
+    g_wq.shutdown = 1;
+    wq_wake_not_empty();
+    wq_unlock();
+
+#ifdef _WIN32
+    WaitForSingleObject(g_wq.thread, INFINITE);
+    CloseHandle(g_wq.thread);
+    DeleteCriticalSection(&g_wq.lock);
+#else
+    pthread_join(g_wq.thread, NULL);
+    pthread_mutex_destroy(&g_wq.lock);
+    pthread_cond_destroy(&g_wq.not_empty);
+    pthread_cond_destroy(&g_wq.not_full);
+#endif
+
+#ifdef HAVE_IO_URING
+    uring_destroy();
+#endif
+
+    g_wq.started = 0;
+}
+
+/**
+ * @brief 异步写出文件：拷贝数据入队后立即返回
+ *
+ * 写线程未启动时回退为同步写。队列满时按策略阻塞或丢弃。
+ *
+ * @return 成功入队（或同步写出）返回0，丢弃或失败返回-1
+ */
+static int writeback_enqueue(const char* filename, const uint8_t* data,
+                             size_t size)
+{
+    if (!g_wq.started) {
+        return write_file_sync(filename, data, size);
+    }
+
+    uint8_t* copy = (uint8_t*)malloc(size);
+    if (!copy) {
+        printf("Failed to allocate writeback copy (%zu bytes)\n", size);
+        return -1;
+    }
+    memcpy(copy, data, size);
+
+    wq_lock();
+    while (g_wq.count == WRITEQ_DEPTH && !g_wq.drop_on_full) {
+        wq_wait_not_full();
+    }
+
+    if (g_wq.count == WRITEQ_DEPTH) {
+        g_wq.write_drops++;
+        wq_unlock();
+        free(copy);
+        return -1;
+    }
+
+    int idx = (g_wq.head + g_wq.count) % WRITEQ_DEPTH;
+    snprintf(g_wq.jobs[idx].filename, MAX_FILENAME_LEN, "%s", filename);
+    g_wq.jobs[idx].data = copy;
+    g_wq.jobs[idx].size = size;
+    g_wq.count++;
+    if (g_wq.count > g_wq.peak_depth) {
+        g_wq.peak_depth = g_wq.count;
+    }
+    wq_wake_not_empty();
+    wq_unlock();
+
+    return 0;
+}
+
+// ========================== 容器捕获文件 ==========================
+
+/** @brief 容器写入器stdio缓冲区大小（追加写合并为大块顺序IO） */
+#define CONTAINER_IO_BUFSIZE (4 * 1024 * 1024)
+
+/**
+ * @struct container_writer
+ * @brief 容器捕获文件写入器状态
+ *
+ * 单个追加写文件替代逐帧的open/write/close：消除每帧的文件
+ * 创建开销和目录项膨胀，磁盘侧始终是纯顺序写。索引在内存中
+ * 累积，关闭时作为尾部一次性写出。仅在处理线程中调用
+ * container_append，无需加锁。
+ */
+struct container_writer {
+    FILE* fp;                             /**< 容器文件句柄 */
+    char* io_buffer;                      /**< stdio写缓冲区 */
+    struct container_index_entry* entries; /**< 内存中的帧索引 */
+    uint32_t entry_count;                 /**< 已记录的帧数 */
+    uint32_t entry_capacity;              /**< 索引数组容量 */
+    uint64_t write_offset;                /**< 当前追加偏移 */
+    int active;                           /**< 写入器是否已打开 */
+};
+
+/** @brief 全局容器写入器 */
+static struct container_writer g_cap;
+
+/**
+ * @brief 在输出目录下创建容器捕获文件
+ *
+ * 文件名带时间戳，避免覆盖上一次采集的结果。
+ */
+int container_open(const char* output_dir)
+{
+    char path[MAX_FILENAME_LEN];
+    time_t now = time(NULL);
+    struct tm* tm_info = localtime(&now);
+
+    snprintf(path, sizeof(path), "%s/capture_%04d%02d%02d_%02d%02d%02d.v4lcap",
+             output_dir,
+             tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
+             tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
+
+    g_cap.fp = fopen(path, "wb");
+    if (!g_cap.fp) {
+        printf("Failed to create capture container: %s\n", path);
+        return -1;
+    }
+
+    g_cap.io_buffer = (char*)malloc(CONTAINER_IO_BUFSIZE);
+    if (g_cap.io_buffer) {
+        setvbuf(g_cap.fp, g_cap.io_buffer, _IOFBF, CONTAINER_IO_BUFSIZE);
+    }
+
+    struct container_file_header file_header;
+    file_header.magic = CONTAINER_MAGIC;
+    file_header.version = CONTAINER_VERSION;
+    file_header.reserved = 0;
+
+    if (fwrite(&file_header, sizeof(file_header), 1, g_cap.fp) != 1) {
+        printf("Failed to write container header\n");
+        fclose(g_cap.fp);
+        g_cap.fp = NULL;
+        return -1;
+    }
+
+    g_cap.entries = NULL;
+    g_cap.entry_count = 0;
+    g_cap.entry_capacity = 0;
+    g_cap.write_offset = sizeof(file_header);
+    g_cap.active = 1;
+
+    printf("Capture container: %s\n", path);
+    return 0;
+}
+
+/**
+ * @brief 向容器追加一帧（frame_header + 负载）并登记索引
+ */
+int container_append(const struct frame_header* header,
+                     const uint8_t* data, size_t size)
+{
+    if (!g_cap.active) {
+        return -1;
+    }
+
+    // 索引数组按需倍增
+    if (g_cap.entry_count == g_cap.entry_capacity) {
+        uint32_t new_cap = g_cap.entry_capacity ? g_cap.entry_capacity * 2 : 256;
+        struct container_index_entry* new_entries = (struct container_index_entry*)
+            realloc(g_cap.entries, new_cap * sizeof(*new_entries));
+        if (!new_entries) {
+            printf("Failed to grow container index\n");
+            return -1;
+        }
+        g_cap.entries = new_entries;
+        g_cap.entry_capacity = new_cap;
+    }
+
+    // 记录中的size以实际写入的负载为准（解压后的帧与header.size不同），
+    // 并清除压缩标志：容器里存放的始终是解压后的数据
+    struct frame_header record = *header;
+    record.size = (uint32_t)size;
+    record.reserved[0] = 0;
+
+    if (fwrite(&record, sizeof(record), 1, g_cap.fp) != 1 ||
+        (size > 0 && fwrite(data, 1, size, g_cap.fp) != size)) {
+        printf("Failed to append frame %d to container\n", header->frame_id);
+        return -1;
+    }
+
+    struct container_index_entry* entry = &g_cap.entries[g_cap.entry_count++];
+    entry->frame_id = header->frame_id;
+    entry->size = (uint32_t)size;
+    entry->offset = g_cap.write_offset;
+    entry->timestamp = header->timestamp;
+
+    g_cap.write_offset += sizeof(record) + size;
+    return 0;
+}
+
+/**
+ * @brief 写出索引与尾部结构并关闭容器文件
+ */
+void container_close(void)
+{
+    if (!g_cap.active) {
+        return;
+    }
+
+    struct container_trailer trailer;
+    trailer.magic = CONTAINER_INDEX_MAGIC;
+    trailer.entry_count = g_cap.entry_count;
+    trailer.index_offset = g_cap.write_offset;
+
+    int ok = 1;
+    if (g_cap.entry_count > 0 &&
+        fwrite(g_cap.entries, sizeof(*g_cap.entries), g_cap.entry_count,
+               g_cap.fp) != g_cap.entry_count) {
+        ok = 0;
+    }
+    if (ok && fwrite(&trailer, sizeof(trailer), 1, g_cap.fp) != 1) {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("Failed to write container index\n");
+    }
+
+    fclose(g_cap.fp);
+    free(g_cap.io_buffer);
+    free(g_cap.entries);
+
+    printf("Capture container closed: %d frames, %.2f MB (+%zu bytes index)\n",
+           g_cap.entry_count,
+           g_cap.write_offset / 1024.0 / 1024.0,
+           g_cap.entry_count * sizeof(struct container_index_entry) +
+               sizeof(trailer));
+
+    memset(&g_cap, 0, sizeof(g_cap));
+}
+
+// ========================== 共享内存帧总线 ==========================
+
+/** @brief 帧总线头部独占区大小（一页，槽位从页边界开始） */
+#define SHM_BUS_HEADER_SIZE 4096
+
+/** @brief 帧总线映射区总大小 */
+#define SHM_BUS_MAP_SIZE                                              \
+    (SHM_BUS_HEADER_SIZE +                                            \
+     (size_t)SHM_BUS_SLOTS *                                          \
+         (sizeof(struct shm_bus_slot_header) + SHM_BUS_SLOT_SIZE))
+
+// seqlock依赖的写/读内存屏障
+#ifdef _WIN32
+#define shm_barrier() MemoryBarrier()
+#else
+#define shm_barrier() __sync_synchronize()
+#endif
+
+/**
+ * @struct shm_bus
+ * @brief 帧总线本地状态（发布端与订阅端共用）
+ */
+struct shm_bus {
+    uint8_t* base;   /**< 共享内存映射基地址 */
+    int is_writer;   /**< 本进程是否为发布端 */
+    int active;      /**< 总线是否已映射 */
+#ifdef _WIN32
+    HANDLE mapping;  /**< 文件映射句柄 */
+#else
+    int fd;                         /**< shm文件描述符 */
+    char shm_path[MAX_FILENAME_LEN]; /**< shm对象路径（带前导'/'） */
+#endif
+};
+
+/** @brief 全局帧总线状态 */
+static struct shm_bus g_bus;
+
+/**
+ * @brief 取槽位头指针
+ */
+static struct shm_bus_slot_header* shm_bus_slot(int idx)
+{
+    return (struct shm_bus_slot_header*)
+        (g_bus.base + SHM_BUS_HEADER_SIZE +
+         (size_t)idx * (sizeof(struct shm_bus_slot_header) + SHM_BUS_SLOT_SIZE));
+}
+
+/**
+ * @brief 取槽位数据区指针
+ */
+static uint8_t* shm_bus_slot_data(int idx)
+{
+    return (uint8_t*)shm_bus_slot(idx) + sizeof(struct shm_bus_slot_header);
+}
+
+/**
+ * @brief 创建并映射共享内存帧总线（发布端）
+ */
+int shm_bus_create(const char* name)
+{
+    memset(&g_bus, 0, sizeof(g_bus));
+
+#ifdef _WIN32
+    g_bus.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+                                       PAGE_READWRITE,
+                                       (DWORD)((uint64_t)SHM_BUS_MAP_SIZE >> 32),
+                                       (DWORD)(SHM_BUS_MAP_SIZE & 0xFFFFFFFF),
+                                       name);
+    if (!g_bus.mapping) {
+        printf("Failed to create shared memory bus '%s'\n", name);
+        return -1;
+    }
+    g_bus.base = (uint8_t*)MapViewOfFile(g_bus.mapping, FILE_MAP_ALL_ACCESS,
+                                         0, 0, SHM_BUS_MAP_SIZE);
+    if (!g_bus.base) {
+        printf("Failed to map shared memory bus\n");
+        CloseHandle(g_bus.mapping);
+        return -1;
+    }
+#else
+    // POSIX共享内存对象名必须以'/'开头
+    snprintf(g_bus.shm_path, sizeof(g_bus.shm_path), "/%s", name);
+    g_bus.fd = shm_open(g_bus.shm_path, O_CREAT | O_RDWR, 0666);
+    if (g_bus.fd < 0) {
+        printf("Failed to create shared memory bus '%s': %s\n",
+               name, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(g_bus.fd, (off_t)SHM_BUS_MAP_SIZE) < 0) {
+        printf("Failed to size shared memory bus: %s\n", strerror(errno));
+        close(g_bus.fd);
+        shm_unlink(g_bus.shm_path);
+        return -1;
+    }
+    g_bus.base = (uint8_t*)mmap(NULL, SHM_BUS_MAP_SIZE,
+                                PROT_READ | PROT_WRITE, MAP_SHARED,
+                                g_bus.fd, 0);
+    if (g_bus.base == MAP_FAILED) {
+        printf("Failed to map shared memory bus: %s\n", strerror(errno));
+        close(g_bus.fd);
+        shm_unlink(g_bus.shm_path);
+        g_bus.base = NULL;
+        return -1;
+    }
+#endif
+
+    memset(g_bus.base, 0, SHM_BUS_MAP_SIZE);
+
+    struct shm_bus_header* bus = (struct shm_bus_header*)g_bus.base;
+    bus->version = SHM_BUS_VERSION;
+    bus->num_slots = SHM_BUS_SLOTS;
+    bus->slot_size = SHM_BUS_SLOT_SIZE;
+    bus->latest = SHM_BUS_SLOTS - 1;  // 首次发布落到槽位0
+    shm_barrier();
+    bus->magic = SHM_BUS_MAGIC;  // 魔数最后写入，订阅端见到即整体就绪
+
+    g_bus.is_writer = 1;
+    g_bus.active = 1;
+
+    printf("Shared memory frame bus: %s (%d slots x %.1f MB)\n",
+           name, SHM_BUS_SLOTS, SHM_BUS_SLOT_SIZE / (1024.0 * 1024.0));
+    return 0;
+}
+
+/**
+ * @brief 发布一帧到总线
+ *
+ * 写入在seqlock奇数窗口内进行：订阅端据此检测撕裂并重读。
+ * convert非零且为SBGGR10时直接解包进共享内存槽位（省一次
+ * 中间拷贝），pixfmt改写为BYR2（16位Bayer）。
+ */
+void shm_bus_publish(const struct frame_header* header,
+                     const uint8_t* data, size_t size, int convert)
+{
+    if (!g_bus.active || !g_bus.is_writer) {
+        return;
+    }
+
+    struct shm_bus_header* bus = (struct shm_bus_header*)g_bus.base;
+    int idx = (int)((bus->latest + 1) % SHM_BUS_SLOTS);
+    struct shm_bus_slot_header* slot = shm_bus_slot(idx);
+    uint8_t* slot_data = shm_bus_slot_data(idx);
+
+    uint32_t out_pixfmt = header->pixfmt;
+    size_t out_size = size;
+
+    slot->seq++;  // 进入写入窗口（奇数）
+    shm_barrier();
+
+    if (convert && header->pixfmt == 0x30314742 && size % 5 == 0 &&
+        size / 5 * 4 * sizeof(uint16_t) <= SHM_BUS_SLOT_SIZE) {
+        size_t num_pixels = size / 5 * 4;
+        unpack_sbggr10_image(data, size, (uint16_t*)slot_data, num_pixels);
+        out_size = num_pixels * sizeof(uint16_t);
+        out_pixfmt = 0x32525942;  // V4L2_PIX_FMT_SBGGR16 "BYR2"
+    } else if (size <= SHM_BUS_SLOT_SIZE) {
+        memcpy(slot_data, data, size);
+    } else {
+        // 帧超出槽位容量：关闭写入窗口并放弃本帧
+        shm_barrier();
+        slot->seq++;
+        return;
+    }
+
+    slot->frame_id = header->frame_id;
+    slot->width = header->width;
+    slot->height = header->height;
+    slot->pixfmt = out_pixfmt;
+    slot->size = (uint32_t)out_size;
+    slot->timestamp = header->timestamp;
+
+    shm_barrier();
+    slot->seq++;  // 退出写入窗口（偶数）
+    shm_barrier();
+
+    bus->latest = (uint32_t)idx;
+    bus->publish_count++;
+}
+
+/**
+ * @brief 解除映射并销毁帧总线
+ */
+void shm_bus_destroy(void)
+{
+    if (!g_bus.active) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(g_bus.base);
+    CloseHandle(g_bus.mapping);
+#else
+    munmap(g_bus.base, SHM_BUS_MAP_SIZE);
+    close(g_bus.fd);
+    if (g_bus.is_writer) {
+        shm_unlink(g_bus.shm_path);
+    }
+#endif
+
+    memset(&g_bus, 0, sizeof(g_bus));
+}
+
+/**
+ * @brief 打开已存在的帧总线（订阅端）
+ */
+int shm_bus_open(const char* name)
+{
+    memset(&g_bus, 0, sizeof(g_bus));
+
+#ifdef _WIN32
+    g_bus.mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if (!g_bus.mapping) {
+        return -1;
+    }
+    g_bus.base = (uint8_t*)MapViewOfFile(g_bus.mapping, FILE_MAP_READ,
+                                         0, 0, SHM_BUS_MAP_SIZE);
+    if (!g_bus.base) {
+        CloseHandle(g_bus.mapping);
+        return -1;
+    }
+#else
+    snprintf(g_bus.shm_path, sizeof(g_bus.shm_path), "/%s", name);
+    g_bus.fd = shm_open(g_bus.shm_path, O_RDONLY, 0);
+    if (g_bus.fd < 0) {
+        return -1;
+    }
+    g_bus.base = (uint8_t*)mmap(NULL, SHM_BUS_MAP_SIZE, PROT_READ,
+                                MAP_SHARED, g_bus.fd, 0);
+    if (g_bus.base == MAP_FAILED) {
+        close(g_bus.fd);
+        g_bus.base = NULL;
+        return -1;
+    }
+#endif
+
+    const struct shm_bus_header* bus = (const struct shm_bus_header*)g_bus.base;
+    if (bus->magic != SHM_BUS_MAGIC || bus->version != SHM_BUS_VERSION ||
+        bus->num_slots != SHM_BUS_SLOTS ||
+        bus->slot_size != SHM_BUS_SLOT_SIZE) {
+        shm_bus_close();
+        return -1;
+    }
+
+    g_bus.active = 1;
+    return 0;
+}
+
+/**
+ * @brief 读取总线上最新的一帧
+ *
+ * seqlock读取方协议：拷贝前后各读一次槽位seq，奇数或两次
+ * 不一致则说明撞上写入，换最新槽位重试。
+ *
+ * @return 成功返回负载字节数，总线为空或重试耗尽返回-1
+ */
+int shm_bus_read_latest(struct frame_header* header,
+                        uint8_t* out, size_t max_size)
+{
+    if (!g_bus.active) {
+        return -1;
+    }
+
+    const struct shm_bus_header* bus = (const struct shm_bus_header*)g_bus.base;
+    if (bus->publish_count == 0) {
+        return -1;
+    }
+
+    for (int retry = 0; retry < 16; retry++) {
+        int idx = (int)(bus->latest % SHM_BUS_SLOTS);
+        struct shm_bus_slot_header* slot = shm_bus_slot(idx);
+
+        uint32_t seq1 = slot->seq;
+        if (seq1 & 1) {
+            continue;  // 写入进行中
         }
-#else
-        if (pthread_create(&threads[i], NULL, unpack_worker_thread, &tasks[i]) != 0) {
+        shm_barrier();
+
+        uint32_t size = slot->size;
+        if (size > max_size) {
             return -1;
         }
-#endif
+
+        header->magic = 0xDEADBEEF;
+        header->frame_id = slot->frame_id;
+        header->width = slot->width;
+        header->height = slot->height;
+        header->pixfmt = slot->pixfmt;
+        header->size = size;
+        header->timestamp = slot->timestamp;
+        header->reserved[0] = 0;
+        header->reserved[1] = 0;
+        memcpy(out, shm_bus_slot_data(idx), size);
+
+        shm_barrier();
+        if (slot->seq == seq1) {
+            return (int)size;
+        }
     }
-    
-    // 等待所有线程完成
-    for (int i = 0; i < num_threads; i++) {
+
+    return -1;
+}
+
+/**
+ * @brief 关闭订阅端映射
+ */
+void shm_bus_close(void)
+{
 #ifdef _WIN32
-        WaitForSingleObject(threads[i], INFINITE);
-        CloseHandle(threads[i]);
+    if (g_bus.base) {
+        UnmapViewOfFile(g_bus.base);
+    }
+    if (g_bus.mapping) {
+        CloseHandle(g_bus.mapping);
+    }
 #else
-        pthread_join(threads[i], NULL);
-#endif
+    if (g_bus.base) {
+        munmap(g_bus.base, SHM_BUS_MAP_SIZE);
     }
-    
-    uint64_t end_time = get_time_ns();
-    double elapsed_ms = (end_time - start_time) / 1000000.0;
-    double throughput = (raw_size / 1024.0 / 1024.0) / (elapsed_ms / 1000.0);
-    
-    static int call_count = 0;
-    call_count++;
-    if (call_count <= 3 || call_count % 50 == 0) {
-        printf("SBGGR10 unpacking: %.1f ms, %.1f MB/s\n", elapsed_ms, throughput);
+    if (g_bus.fd > 0) {
+        close(g_bus.fd);
     }
-    
-    return 0;
+#endif
+    memset(&g_bus, 0, sizeof(g_bus));
 }
 
 // ========================== 图像数据处理函数 ==========================
@@ -520,21 +3077,11 @@ int save_frame(const uint8_t* data, size_t size, uint32_t frame_id,
         ext = "BG10";
     }
 
-    // 保存原始RAW数据
+    // 保存原始RAW数据（入队异步写出）
     snprintf(filename, sizeof(filename), "%s/frame_%06d_%dx%d.%s",
              output_dir, frame_id, width, height, ext);
 
-    FILE* fp = fopen(filename, "wb");
-    if (!fp) {
-        printf("Failed to open output file: %s\n", filename);
-        return -1;
-    }
-
-    size_t written = fwrite(data, 1, size, fp);
-    fclose(fp);
-
-    if (written != size) {
-        printf("Warning: wrote %zu bytes instead of %zu\n", written, size);
+    if (writeback_enqueue(filename, data, size) < 0) {
         ret = -1;
     }
 
@@ -552,23 +3099,12 @@ int save_frame(const uint8_t* data, size_t size, uint32_t frame_id,
         
         if (unpacked_pixels) {
             if (unpack_sbggr10_image(data, size, unpacked_pixels, num_pixels) == 0) {
-                // 保存解包后的16位数据
+                // 保存解包后的16位数据（入队异步写出）
                 snprintf(filename, sizeof(filename), "%s/frame_%06d_%dx%d_unpacked.raw",
                         output_dir, frame_id, width, height);
-                
-                FILE* fp_unpacked = fopen(filename, "wb");
-                if (fp_unpacked) {
-                    size_t unpacked_size = num_pixels * sizeof(uint16_t);
-                    size_t written_unpacked = fwrite(unpacked_pixels, 1, unpacked_size, fp_unpacked);
-                    fclose(fp_unpacked);
-                    
-                    if (written_unpacked != unpacked_size) {
-                        printf("Warning: unpacked write incomplete (%zu/%zu bytes)\n", 
-                               written_unpacked, unpacked_size);
-                        ret = -1;
-                    }
-                } else {
-                    printf("Failed to open unpacked output file: %s\n", filename);
+
+                if (writeback_enqueue(filename, (const uint8_t*)unpacked_pixels,
+                                      num_pixels * sizeof(uint16_t)) < 0) {
                     ret = -1;
                 }
             } else {
@@ -591,31 +3127,50 @@ int save_frame(const uint8_t* data, size_t size, uint32_t frame_id,
 
 /**
  * @brief 仅在内存中处理图像帧数据（不保存文件）
+ *
+ * 启用去马赛克时在解包后追加双线性BGGR去马赛克，RGB888结果
+ * 留在g_rgb_buffer中供查看器通过库接口取用。
  */
 int process_frame_memory_only(const uint8_t* data, size_t size, uint32_t frame_id,
-                              uint32_t pixfmt, int enable_conversion)
+                              uint32_t width, uint32_t height, uint32_t pixfmt,
+                              int enable_conversion, int enable_debayer)
 {
     // 仅处理SBGGR10格式转换（如果启用）
     if (enable_conversion && pixfmt == 0x30314742 && size % 5 == 0) {
         size_t num_pixels = size / 5 * 4;
         uint16_t* unpacked_pixels = NULL;
-        
+
         // 尝试使用预分配的内存池
         if (g_unpack_buffer && num_pixels <= g_buffer_size) {
             unpacked_pixels = g_unpack_buffer;
         } else {
             unpacked_pixels = (uint16_t*)malloc(num_pixels * sizeof(uint16_t));
         }
-        
+
         if (unpacked_pixels) {
             if (unpack_sbggr10_image(data, size, unpacked_pixels, num_pixels) == 0) {
                 // 数据已在内存中处理完成，无需保存文件
                 static int process_count = 0;
                 process_count++;
                 if (process_count <= 3 || process_count % 100 == 0) {
-                    printf("Frame %d: SBGGR10 converted in memory (%zu pixels)\n", 
+                    printf("Frame %d: SBGGR10 converted in memory (%zu pixels)\n",
                            frame_id, num_pixels);
                 }
+
+                // 去马赛克预览级：RGB888写入预分配缓冲区
+                if (enable_debayer && g_rgb_buffer &&
+                    num_pixels == (size_t)width * height &&
+                    num_pixels * 3 <= g_rgb_buffer_size) {
+                    uint64_t t0 = get_time_ns();
+                    if (debayer_bggr10_to_rgb888(unpacked_pixels, g_rgb_buffer,
+                                                 width, height) == 0) {
+                        if (process_count <= 3 || process_count % 100 == 0) {
+                            printf("Frame %d: debayered to RGB888 in %.2f ms\n",
+                                   frame_id,
+                                   (get_time_ns() - t0) / 1000000.0);
+                        }
+                    }
+                }
             } else {
                 printf("Failed to unpack SBGGR10 data in memory\n");
                 if (unpacked_pixels != g_unpack_buffer) {
@@ -623,7 +3178,7 @@ int process_frame_memory_only(const uint8_t* data, size_t size, uint32_t frame_i
                 }
                 return -1;
             }
-            
+
             // 只有不是预分配缓冲区时才需要释放
             if (unpacked_pixels != g_unpack_buffer) {
                 free(unpacked_pixels);
@@ -633,7 +3188,7 @@ int process_frame_memory_only(const uint8_t* data, size_t size, uint32_t frame_i
             return -1;
         }
     }
-    
+
     return 0;
 }
 
@@ -654,10 +3209,87 @@ void print_frame_info(const struct frame_header* header)
 
 // ========================== 性能统计函数 ==========================
 
+/** @brief 逐帧CSV记录文件（NULL表示未启用） */
+static FILE* g_stats_csv = NULL;
+
+/**
+ * @brief 记录一个延迟样本到log2直方图
+ */
+static inline void pc_hist_record(struct latency_hist* h, uint64_t us)
+{
+    int bucket = 0;
+    uint64_t v = us | 1;
+    while (v >>= 1) {
+        bucket++;
+    }
+    if (bucket >= PC_HIST_BUCKETS) {
+        bucket = PC_HIST_BUCKETS - 1;
+    }
+
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    h->buckets[bucket]++;
+}
+
+/**
+ * @brief 从log2直方图估计百分位（返回所在桶的上界，微秒）
+ */
+static uint64_t pc_hist_percentile(const struct latency_hist* h, double pct)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    uint64_t threshold = (uint64_t)(h->count * pct / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < PC_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > threshold) {
+            return 2ull << i;
+        }
+    }
+    return h->max_us;
+}
+
+/**
+ * @brief 打开逐帧CSV记录文件并写表头
+ */
+int stats_csv_open(const char* path)
+{
+    g_stats_csv = fopen(path, "w");
+    if (!g_stats_csv) {
+        printf("Failed to create CSV log: %s\n", path);
+        return -1;
+    }
+
+    fprintf(g_stats_csv,
+            "frame_id,wire_bytes,device_timestamp_ns,recv_time_ns,"
+            "latency_us,gap_frames\n");
+    printf("Per-frame CSV log: %s\n", path);
+    return 0;
+}
+
+/**
+ * @brief 关闭CSV记录文件
+ */
+void stats_csv_close(void)
+{
+    if (g_stats_csv) {
+        fclose(g_stats_csv);
+        g_stats_csv = NULL;
+    }
+}
+
 /**
  * @brief 更新传输性能统计信息
+ *
+ * 首帧时把(接收时刻 - 设备时间戳)作为时钟偏移基准，此后
+ * 每帧的偏差即相对首帧的附加延迟；frame_id出现间隙计为丢帧。
  */
-void update_stats(uint32_t frame_size)
+void update_stats(const struct frame_header* header)
 {
     uint64_t current_time = get_time_ns();
 
@@ -666,7 +3298,38 @@ void update_stats(uint32_t frame_size)
     }
 
     stats.frames_received++;
-    stats.bytes_received += frame_size;
+    stats.bytes_received += header->size;
+
+    // frame_id间隙 => 设备端或传输途中被丢弃的帧
+    uint32_t gap = 0;
+    if (stats.have_last_id) {
+        if (header->frame_id > stats.last_frame_id + 1) {
+            gap = header->frame_id - stats.last_frame_id - 1;
+            stats.frames_dropped += gap;
+        } else if (header->frame_id < stats.last_frame_id) {
+            // 服务端重启导致序号回绕：重新建立基准
+            stats.have_offset = 0;
+        }
+    }
+    stats.last_frame_id = header->frame_id;
+    stats.have_last_id = 1;
+
+    // 设备到PC延迟（相对首帧的时钟偏移）
+    int64_t latency_us = -1;
+    if (header->timestamp > 0) {
+        if (!stats.have_offset) {
+            stats.clock_offset_ns =
+                (int64_t)(current_time - header->timestamp);
+            stats.have_offset = 1;
+        }
+        int64_t lat_ns = (int64_t)(current_time - header->timestamp) -
+                         stats.clock_offset_ns;
+        if (lat_ns < 0) {
+            lat_ns = 0;
+        }
+        latency_us = lat_ns / 1000;
+        pc_hist_record(&stats.latency, (uint64_t)latency_us);
+    }
 
     // 计算FPS
     if (stats.last_frame_time > 0) {
@@ -677,6 +3340,15 @@ void update_stats(uint32_t frame_size)
     }
 
     stats.last_frame_time = current_time;
+
+    // 逐帧CSV记录（stdio缓冲合并写出）
+    if (g_stats_csv) {
+        fprintf(g_stats_csv, "%u,%u,%llu,%llu,%lld,%u\n",
+                header->frame_id, header->size,
+                (unsigned long long)header->timestamp,
+                (unsigned long long)current_time,
+                (long long)latency_us, gap);
+    }
 }
 
 /**
@@ -689,25 +3361,274 @@ void print_stats(void)
     double mbps = (stats.bytes_received / 1024.0 / 1024.0) / elapsed_sec;
 
     printf("\n=== Statistics ===\n");
-    printf("Frames received: %d\n", stats.frames_received);
-    printf("Bytes received: %d (%.2f MB)\n", stats.bytes_received,
+    printf("Frames received: %llu\n",
+           (unsigned long long)stats.frames_received);
+    printf("Bytes received: %llu (%.2f MB)\n",
+           (unsigned long long)stats.bytes_received,
            stats.bytes_received / 1024.0 / 1024.0);
+    printf("Frames dropped (id gaps): %llu\n",
+           (unsigned long long)stats.frames_dropped);
     printf("Elapsed time: %.2f seconds\n", elapsed_sec);
     printf("Average FPS: %.2f\n", stats.avg_fps);
     printf("Data rate: %.2f MB/s\n", mbps);
+
+    // 设备到PC延迟分布（相对首帧时钟偏移基准）
+    if (stats.latency.count > 0) {
+        printf("Latency vs first frame: p50 %llu us, p95 %llu us, "
+               "p99 %llu us, max %llu us (avg %.0f us)\n",
+               (unsigned long long)pc_hist_percentile(&stats.latency, 50.0),
+               (unsigned long long)pc_hist_percentile(&stats.latency, 95.0),
+               (unsigned long long)pc_hist_percentile(&stats.latency, 99.0),
+               (unsigned long long)stats.latency.max_us,
+               (double)stats.latency.sum_us / stats.latency.count);
+    }
+
+    // CRC32C校验统计
+    if (stats.crc_checked > 0) {
+        printf("CRC32C verified: %llu frames, %llu mismatches\n",
+               (unsigned long long)stats.crc_checked,
+               (unsigned long long)stats.crc_mismatches);
+    }
+
+    // 处理级各阶段平均耗时
+    if (stats.frames_received > 0 &&
+        (stats.stage_decomp_ns > 0 || stats.stage_process_ns > 0)) {
+        printf("Stage time per frame: decompress %.2f ms, process %.2f ms\n",
+               stats.stage_decomp_ns / 1000000.0 / stats.frames_received,
+               stats.stage_process_ns / 1000000.0 / stats.frames_received);
+    }
+
+    // 异步写回统计
+    if (g_wq.writes_done > 0 || g_wq.write_drops > 0) {
+        double avg_ms = g_wq.writes_done > 0
+                            ? g_wq.total_write_ns / 1000000.0 / g_wq.writes_done
+                            : 0.0;
+        printf("Async writes: %llu (%.2f MB, avg %.2f ms, max %.2f ms)\n",
+               (unsigned long long)g_wq.writes_done,
+               g_wq.bytes_written / 1024.0 / 1024.0,
+               avg_ms,
+               g_wq.max_write_ns / 1000000.0);
+        printf("Write queue: peak depth %d/%d, dropped saves %llu\n",
+               g_wq.peak_depth,
+               WRITEQ_DEPTH,
+               (unsigned long long)g_wq.write_drops);
+    }
+}
+
+// ========================== 流水线接收 ==========================
+
+/** @brief 接收流水线的帧槽位数（须容纳最多4路条带流各占一槽） */
+#define RECV_RING_SLOTS 8
+
+/** @brief 槽位状态：空闲，可被接收线程认领 */
+#define SLOT_FREE 0
+
+/** @brief 槽位状态：接收线程正在填充 */
+#define SLOT_FILLING 1
+
+/** @brief 槽位状态：填充完成，等待处理 */
+#define SLOT_READY 2
+
+/** @brief 槽位状态：处理线程正在消费 */
+#define SLOT_PROCESSING 3
+
+/**
+ * @struct recv_slot
+ * @brief 流水线中的单个帧槽位
+ */
+struct recv_slot {
+    struct frame_header header; /**< 帧头 */
+    uint8_t* data;              /**< 负载缓冲区（取自帧缓冲池） */
+    int state;                  /**< SLOT_*状态 */
+    int stream;                 /**< 填充本槽位的条带流序号 */
+};
+
+/**
+ * @struct recv_pipeline
+ * @brief 两级接收流水线状态
+ *
+ * 每路条带流一个专职接收线程，持续排空自己的socket并填充
+ * 认领的槽位；处理线程按frame_id从就绪槽位中挑最小的消费，
+ * 把条带流间的乱序收敛回帧序。单流时退化为原先的单接收
+ * 线程流水线。
+ */
+struct recv_pipeline {
+    struct recv_slot slots[RECV_RING_SLOTS]; /**< 帧槽位池 */
+    int stream_done[MAX_STRIPE_STREAMS]; /**< 各流结束标志 */
+    int num_streams;                     /**< 条带流数量 */
+    int credit_mode;                     /**< 信用流控是否启用 */
+    socket_t socks[MAX_STRIPE_STREAMS]; /**< 各路流的数据socket */
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE not_empty;
+    CONDITION_VARIABLE not_full;
+    HANDLE threads[MAX_STRIPE_STREAMS];
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t threads[MAX_STRIPE_STREAMS];
+#endif
+};
+
+/** @brief 全局接收流水线 */
+static struct recv_pipeline g_rx;
+
+#ifdef _WIN32
+#define rx_lock()           EnterCriticalSection(&g_rx.lock)
+#define rx_unlock()         LeaveCriticalSection(&g_rx.lock)
+#define rx_wait_not_empty() SleepConditionVariableCS(&g_rx.not_empty, &g_rx.lock, INFINITE)
+#define rx_wait_not_full()  SleepConditionVariableCS(&g_rx.not_full, &g_rx.lock, INFINITE)
+#define rx_wake_not_empty() WakeAllConditionVariable(&g_rx.not_empty)
+#define rx_wake_not_full()  WakeAllConditionVariable(&g_rx.not_full)
+#else
+#define rx_lock()           pthread_mutex_lock(&g_rx.lock)
+#define rx_unlock()         pthread_mutex_unlock(&g_rx.lock)
+#define rx_wait_not_empty() pthread_cond_wait(&g_rx.not_empty, &g_rx.lock)
+#define rx_wait_not_full()  pthread_cond_wait(&g_rx.not_full, &g_rx.lock)
+#define rx_wake_not_empty() pthread_cond_broadcast(&g_rx.not_empty)
+#define rx_wake_not_full()  pthread_cond_broadcast(&g_rx.not_full)
+#endif
+
+/**
+ * @brief 专职接收线程主体（每路条带流一个）
+ *
+ * 循环认领空闲槽位、从本路socket接收帧头与负载，填充完成后
+ * 交给处理线程。本路连接断开或协议错误时只结束本流，其余
+ * 条带流继续接收，全部结束后处理线程才退出。
+ */
+#ifdef _WIN32
+static unsigned int __stdcall recv_stage_main(void *arg) {
+#else
+static void* recv_stage_main(void *arg) {
+#endif
+    int stream = (int)(intptr_t)arg;
+    socket_t sock = g_rx.socks[stream];
+
+    // 每路流的槽位配额，保证慢流始终能认领到槽位，
+    // 否则快流占满整环会与等待它帧序的处理线程互相卡死
+    int quota = RECV_RING_SLOTS / g_rx.num_streams;
+
+    while (running) {
+        // 认领一个空闲槽位（本流在途槽位不超过配额）
+        rx_lock();
+        int idx = -1;
+        while (running) {
+            int in_flight = 0;
+            for (int i = 0; i < RECV_RING_SLOTS; i++) {
+                if (g_rx.slots[i].state != SLOT_FREE &&
+                    g_rx.slots[i].stream == stream) {
+                    in_flight++;
+                } else if (g_rx.slots[i].state == SLOT_FREE && idx < 0) {
+                    idx = i;
+                }
+            }
+            if (idx >= 0 && in_flight < quota) {
+                break;
+            }
+            idx = -1;
+            rx_wait_not_full();
+        }
+        if (idx < 0) {
+            rx_unlock();
+            break;
+        }
+        g_rx.slots[idx].state = SLOT_FILLING;
+        g_rx.slots[idx].stream = stream;
+        rx_unlock();
+
+        struct recv_slot* slot = &g_rx.slots[idx];
+        int failed = 1;
+
+        // 接收帧头
+        if (recv_full(sock, &slot->header, sizeof(slot->header)) < 0) {
+            goto slot_done;
+        }
+
+        // 验证魔数
+        if (slot->header.magic != 0xDEADBEEF) {
+            printf("Invalid frame magic: 0x%08x\n", slot->header.magic);
+            goto slot_done;
+        }
+
+        // 检查帧大小合理性
+        if (slot->header.size == 0 || slot->header.size > 50 * 1024 * 1024) {
+            printf("Invalid frame size: %d\n", slot->header.size);
+            goto slot_done;
+        }
+
+        // 从帧缓冲池取用本帧的负载缓冲区，处理线程用完归还
+        slot->data = frame_pool_acquire(slot->header.size);
+        if (!slot->data) {
+            printf("Failed to acquire frame buffer (%d bytes)\n",
+                   slot->header.size);
+            goto slot_done;
+        }
+
+        // 接收帧负载
+        if (recv_full(sock, slot->data, slot->header.size) < 0) {
+            goto slot_done;
+        }
+        failed = 0;
+
+slot_done:
+        rx_lock();
+        if (failed) {
+            frame_pool_release(slot->data);
+            slot->data = NULL;
+            slot->state = SLOT_FREE;
+            rx_wake_not_full();
+            rx_unlock();
+            break;
+        }
+        slot->state = SLOT_READY;
+        rx_wake_not_empty();
+        rx_unlock();
+    }
+
+    rx_lock();
+    g_rx.stream_done[stream] = 1;
+    rx_wake_not_empty();
+    rx_wake_not_full();
+    rx_unlock();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
 }
 
 // ========================== 主接收循环 ==========================
 
 /**
- * @brief 图像数据接收主循环
+ * @brief 单流接收主循环（保持原有调用接口）
  */
 int receive_loop(socket_t sock, const struct client_config* config)
 {
-    uint8_t* frame_buffer = NULL;
-    size_t buffer_size = 0;
+    return receive_loop_striped(&sock, 1, config);
+}
+
+/**
+ * @brief 图像数据接收主循环（流水线处理级，支持条带多流）
+ *
+ * 启动每路流的专职接收线程后，本线程作为处理级消费已填充的
+ * 帧槽位：解压、格式转换与文件保存都与下一帧的网络接收并行。
+ * 多流时按frame_id挑最小的就绪槽位，恢复条带化打散的帧序。
+ */
+int receive_loop_striped(socket_t* socks, int num_streams,
+                         const struct client_config* config)
+{
+    if (num_streams < 1 || num_streams > MAX_STRIPE_STREAMS) {
+        printf("Invalid stream count: %d\n", num_streams);
+        return -1;
+    }
 
     printf("Starting receive loop (Ctrl+C to stop)...\n");
+    if (num_streams > 1) {
+        printf("Striped transport: %d streams\n", num_streams);
+    }
     if (config->enable_save) {
         printf("Frames will be saved to: %s\n", config->output_dir);
         printf("SBGGR10 conversion: %s\n", config->enable_conversion ? "Enabled" : "Disabled");
@@ -716,52 +3637,163 @@ int receive_loop(socket_t sock, const struct client_config* config)
         printf("SBGGR10 processing: %s\n", config->enable_conversion ? "In-memory conversion" : "No processing");
     }
 
-    while (running) {
-        struct frame_header header;
-
-        // 接收帧头
-        if (recv_full(sock, &header, sizeof(header)) < 0) {
-            break;
+    // 初始化流水线并启动各路接收线程
+    memset(&g_rx, 0, sizeof(g_rx));
+    g_rx.num_streams = num_streams;
+    g_rx.credit_mode = config->credits > 0;
+    for (int i = 0; i < num_streams; i++) {
+        g_rx.socks[i] = socks[i];
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&g_rx.lock);
+    InitializeConditionVariable(&g_rx.not_empty);
+    InitializeConditionVariable(&g_rx.not_full);
+    for (int i = 0; i < num_streams; i++) {
+        g_rx.threads[i] = (HANDLE)_beginthreadex(NULL, 0, recv_stage_main,
+                                                 (void*)(intptr_t)i, 0, NULL);
+        if (g_rx.threads[i] == 0) {
+            printf("Failed to create receive thread %d\n", i);
+            return -1;
         }
-
-        // 验证魔数
-        if (header.magic != 0xDEADBEEF) {
-            printf("Invalid frame magic: 0x%08x\n", header.magic);
-            break;
+    }
+#else
+    pthread_mutex_init(&g_rx.lock, NULL);
+    pthread_cond_init(&g_rx.not_empty, NULL);
+    pthread_cond_init(&g_rx.not_full, NULL);
+    for (int i = 0; i < num_streams; i++) {
+        if (pthread_create(&g_rx.threads[i], NULL, recv_stage_main,
+                           (void*)(intptr_t)i) != 0) {
+            printf("Failed to create receive thread %d\n", i);
+            return -1;
         }
+    }
+#endif
 
-        // 检查帧大小合理性
-        if (header.size == 0 || header.size > 50 * 1024 * 1024) {
-            printf("Invalid frame size: %d\n", header.size);
+    while (running) {
+        // 等待就绪槽位，多流时取frame_id最小者保持帧序；
+        // 每路流内部有序，等到所有在跑的流都有就绪帧后，
+        // 就绪集合中的最小frame_id必然是全局下一帧
+        rx_lock();
+        int idx = -1;
+        for (;;) {
+            int have_ready[MAX_STRIPE_STREAMS] = {0};
+            int all_done = 1;
+            for (int i = 0; i < RECV_RING_SLOTS; i++) {
+                if (g_rx.slots[i].state != SLOT_READY) {
+                    continue;
+                }
+                have_ready[g_rx.slots[i].stream] = 1;
+                if (idx < 0 ||
+                    g_rx.slots[i].header.frame_id <
+                        g_rx.slots[idx].header.frame_id) {
+                    idx = i;
+                }
+            }
+            int waiting = 0;
+            for (int i = 0; i < num_streams; i++) {
+                if (!g_rx.stream_done[i]) {
+                    all_done = 0;
+                    if (!have_ready[i]) {
+                        waiting = 1;
+                    }
+                }
+            }
+            if ((idx >= 0 && !waiting) || all_done || !running) {
+                break;
+            }
+            idx = -1;
+            rx_wait_not_empty();
+        }
+        if (idx < 0) {
+            rx_unlock();
             break;
         }
-
-        // 重新分配缓冲区（如果需要）
-        if (header.size > buffer_size) {
-            free(frame_buffer);
-            frame_buffer = malloc(header.size);
-            if (!frame_buffer) {
-                printf("Failed to allocate %d bytes for frame buffer\n", header.size);
-                break;
+        g_rx.slots[idx].state = SLOT_PROCESSING;
+        rx_unlock();
+
+        struct recv_slot* slot = &g_rx.slots[idx];
+        struct frame_header header = slot->header;
+
+        // 设备携带CRC32C时（reserved[1]非0）校验线上负载
+        if (header.reserved[1] != 0) {
+            uint32_t crc = g_crc32c(slot->data, header.size);
+            stats.crc_checked++;
+            if (crc != header.reserved[1]) {
+                stats.crc_mismatches++;
+                printf("Frame %u: CRC32C mismatch (0x%08x != 0x%08x)\n",
+                       header.frame_id, crc, header.reserved[1]);
             }
-            buffer_size = header.size;
         }
 
-        // 接收帧数据
-        if (recv_full(sock, frame_buffer, header.size) < 0) {
-            break;
+        // 设备端LZ压缩的帧（reserved[0]==1）：先解压再进入处理流程
+        uint8_t* payload = slot->data;
+        uint8_t* decomp_buffer = NULL;
+        size_t payload_size = header.size;
+        int slot_failed = 0;
+
+        if (header.reserved[0] == 1) {
+            uint64_t decomp_t0 = get_time_ns();
+            // 原始大小由分辨率推出：SBGGR10为5字节/4像素
+            size_t raw_size;
+            if (header.pixfmt == 0x30314742) {
+                raw_size = (size_t)header.width * header.height * 5 / 4;
+            } else {
+                raw_size = (size_t)header.width * header.height * 4;
+            }
+
+            decomp_buffer = frame_pool_acquire(raw_size);
+            if (!decomp_buffer) {
+                printf("Failed to acquire %zu bytes for decompression\n",
+                       raw_size);
+                slot_failed = 1;
+            } else {
+                int dsize = lz_decompress(slot->data, header.size,
+                                          decomp_buffer, raw_size);
+                if (dsize < 0) {
+                    printf("Frame %d: LZ decompression failed\n",
+                           header.frame_id);
+                    slot_failed = 1;
+                } else {
+                    payload = decomp_buffer;
+                    payload_size = (size_t)dsize;
+                }
+            }
+            stats.stage_decomp_ns += get_time_ns() - decomp_t0;
         }
 
         // 打印帧信息
-        print_frame_info(&header);
+        if (!config->quiet) {
+            print_frame_info(&header);
+        }
+
+        // 发布到共享内存帧总线（本地订阅进程零拷贝读取）
+        if (!slot_failed && config->publish) {
+            shm_bus_publish(&header, payload, payload_size,
+                            config->enable_conversion);
+        }
 
         // 处理帧（保存或仅内存处理）
-        if (header.frame_id % config->save_interval == 0) {
-            if (config->enable_save) {
+        if (!slot_failed && header.frame_id % config->save_interval == 0) {
+            uint64_t process_t0 = get_time_ns();
+            if (config->enable_save && config->container_mode) {
+                // 容器模式：追加到单个捕获文件，负载保持接收原样
+                if (container_append(&header, payload, payload_size) == 0 &&
+                    !config->quiet) {
+                    printf("  -> Appended to capture container\n");
+                }
+                if (config->enable_conversion) {
+                    process_frame_memory_only(payload, payload_size,
+                                              header.frame_id, header.width,
+                                              header.height, header.pixfmt,
+                                              config->enable_conversion,
+                                              config->enable_debayer);
+                }
+            } else if (config->enable_save) {
                 // 文件保存模式
-                if (save_frame(frame_buffer, header.size, header.frame_id,
+                if (save_frame(payload, payload_size, header.frame_id,
                               header.width, header.height, header.pixfmt,
-                              config->enable_conversion, config->output_dir) == 0) {
+                              config->enable_conversion, config->output_dir) == 0 &&
+                    !config->quiet) {
                     if (config->enable_conversion && header.pixfmt == 0x30314742) {
                         printf("  -> Saved RAW + unpacked files\n");
                     } else {
@@ -770,8 +3802,11 @@ int receive_loop(socket_t sock, const struct client_config* config)
                 }
             } else {
                 // 仅内存处理模式
-                if (process_frame_memory_only(frame_buffer, header.size, header.frame_id,
-                                            header.pixfmt, config->enable_conversion) == 0) {
+                if (process_frame_memory_only(payload, payload_size, header.frame_id,
+                                            header.width, header.height,
+                                            header.pixfmt, config->enable_conversion,
+                                            config->enable_debayer) == 0 &&
+                    !config->quiet) {
                     if (config->enable_conversion && header.pixfmt == 0x30314742) {
                         printf("  -> Processed in memory (converted)\n");
                     } else {
@@ -779,18 +3814,69 @@ int receive_loop(socket_t sock, const struct client_config* config)
                     }
                 }
             }
+            stats.stage_process_ns += get_time_ns() - process_t0;
         }
 
         // 更新统计
-        update_stats(header.size);
+        update_stats(&header);
 
         // 每100帧显示一次统计
         if (stats.frames_received % 100 == 0) {
-            printf("Received %d frames, avg FPS: %.2f\n",
-                   stats.frames_received, stats.avg_fps);
+            printf("Received %llu frames, avg FPS: %.2f\n",
+                   (unsigned long long)stats.frames_received, stats.avg_fps);
+        }
+
+        // 帧处理完毕：缓冲区归还池，槽位归还接收线程
+        frame_pool_release(decomp_buffer);
+        frame_pool_release(slot->data);
+        slot->data = NULL;
+
+        int credit_stream = slot->stream;
+
+        rx_lock();
+        slot->state = SLOT_FREE;
+        rx_wake_not_full();
+        rx_unlock();
+
+        // 信用流控：每消费一帧在来源流上补发一个信用
+        if (g_rx.credit_mode && !slot_failed) {
+            struct credit_ctrl cc;
+            cc.magic = CREDIT_MAGIC;
+            cc.credits = 1;
+            send(g_rx.socks[credit_stream], (const char*)&cc, sizeof(cc), 0);
+        }
+
+        if (slot_failed) {
+            break;
         }
     }
 
-    free(frame_buffer);
+    // 唤醒可能停靠在条件变量上的接收线程并回收
+    running = 0;
+    rx_lock();
+    rx_wake_not_full();
+    rx_unlock();
+
+#ifdef _WIN32
+    for (int i = 0; i < num_streams; i++) {
+        WaitForSingleObject(g_rx.threads[i], INFINITE);
+        CloseHandle(g_rx.threads[i]);
+    }
+    DeleteCriticalSection(&g_rx.lock);
+#else
+    for (int i = 0; i < num_streams; i++) {
+        pthread_join(g_rx.threads[i], NULL);
+    }
+    pthread_mutex_destroy(&g_rx.lock);
+    pthread_cond_destroy(&g_rx.not_empty);
+    pthread_cond_destroy(&g_rx.not_full);
+#endif
+
+    // 停机时可能有已填充未处理的槽位，把它们的缓冲区归还池
+    for (int i = 0; i < RECV_RING_SLOTS; i++) {
+        frame_pool_release(g_rx.slots[i].data);
+        g_rx.slots[i].data = NULL;
+    }
+
     return 0;
 }
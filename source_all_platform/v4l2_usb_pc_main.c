@@ -28,10 +28,23 @@ void print_usage(const char* prog_name)
     printf("  -S, --save-path DIR Save frames to directory (default: memory only)\n");
     printf("  -o, --output DIR    Alias for --save-path (deprecated)\n");
     printf("  -c, --convert       Enable SBGGR10 to 16-bit conversion (default: disabled)\n");
+    printf("  -D, --debayer       Debayer BGGR frames to RGB888 preview (implies -c)\n");
     printf("  -i, --interval N    Save every Nth frame (default: 1)\n");
+    printf("  -d, --drop-saves    Drop saves when write queue is full instead of blocking\n");
+    printf("  -L, --csv FILE      Append per-frame records (latency, gaps) to a CSV file\n");
+    printf("  -t, --streams N     Stripe frames across N connections, 1-%d (default: 1)\n",
+           MAX_STRIPE_STREAMS);
+    printf("  -w, --credits N     Enable credit flow control with an N-frame window\n");
+    printf("  -H, --hugepages     Back frame/unpack buffers with 2MB huge pages and\n");
+    printf("                       bind them to the receive thread's NUMA node\n");
+    printf("  -F, --container     Append all frames to one indexed capture file (requires -S)\n");
+    printf("  -P, --publish [NAME] Publish frames to a shared-memory bus for local readers\n");
+    printf("                       (default name: %s)\n", SHM_BUS_DEFAULT_NAME);
     printf("\nSave Modes:\n");
     printf("  Memory-only (default): Frames processed in RAM, real-time overwrite\n");
     printf("  File save (-S DIR):    Frames saved to disk for analysis\n");
+    printf("  Container (-S DIR -F): One append-only .v4lcap file with frame index\n");
+    printf("                         (use v4l2_cap_extract to list/extract frames)\n");
     printf("\nExample:\n");
     printf("  %s -s 172.32.0.93                    # Memory-only mode\n", prog_name);
     printf("  %s -s 172.32.0.93 -S ./frames       # Save to files\n", prog_name);
@@ -51,8 +64,18 @@ int parse_arguments(int argc, char* argv[], struct client_config* config)
     config->port = DEFAULT_PORT;
     config->output_dir = NULL;           // 默认不保存到文件
     config->enable_conversion = 0;       // 默认不启用转换
+    config->enable_debayer = 0;          // 默认不去马赛克
     config->save_interval = 1;
     config->enable_save = 0;             // 默认仅内存模式
+    config->drop_saves = 0;              // 默认队列满时阻塞，不丢保存
+    config->container_mode = 0;          // 默认逐帧文件保存
+    config->publish = 0;                 // 默认不发布到共享内存总线
+    config->shm_name = SHM_BUS_DEFAULT_NAME;
+    config->csv_path = NULL;             // 默认不记录CSV
+    config->streams = 1;                 // 默认单TCP流
+    config->credits = 0;                 // 默认不启用信用流控
+    config->hugepages = 0;               // 默认普通分配
+    config->quiet = 0;                   // 默认输出逐帧信息
 
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
@@ -100,9 +123,61 @@ int parse_arguments(int argc, char* argv[], struct client_config* config)
                 return -1;
             }
         }
+        else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--drop-saves") == 0) {
+            config->drop_saves = 1;
+        }
+        else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--streams") == 0) {
+            if (++i < argc) {
+                config->streams = atoi(argv[i]);
+                if (config->streams < 1 || config->streams > MAX_STRIPE_STREAMS) {
+                    printf("Error: --streams must be 1-%d\n", MAX_STRIPE_STREAMS);
+                    return -1;
+                }
+            } else {
+                printf("Error: --streams requires a number\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--hugepages") == 0) {
+            config->hugepages = 1;
+        }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--credits") == 0) {
+            if (i + 1 < argc) {
+                config->credits = atoi(argv[++i]);
+                if (config->credits < 1) {
+                    printf("Error: --credits must be a positive frame count\n");
+                    return -1;
+                }
+            } else {
+                printf("Error: --credits requires a number\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "--csv") == 0) {
+            if (++i < argc) {
+                config->csv_path = argv[i];
+            } else {
+                printf("Error: --csv requires a file path\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "-F") == 0 || strcmp(argv[i], "--container") == 0) {
+            config->container_mode = 1;
+        }
+        else if (strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--publish") == 0) {
+            config->publish = 1;
+            // 可选的总线名称参数
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                config->shm_name = argv[++i];
+            }
+        }
         else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--convert") == 0) {
             config->enable_conversion = 1;
         }
+        else if (strcmp(argv[i], "-D") == 0 || strcmp(argv[i], "--debayer") == 0) {
+            config->enable_debayer = 1;
+            config->enable_conversion = 1;  // 去马赛克依赖解包结果
+        }
         else if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) {
             if (++i < argc) {
                 config->save_interval = atoi(argv[i]);
@@ -122,6 +197,12 @@ int parse_arguments(int argc, char* argv[], struct client_config* config)
         }
     }
 
+    // 容器模式必须配合保存路径使用
+    if (config->container_mode && !config->enable_save) {
+        printf("Error: --container requires --save-path\n");
+        return -1;
+    }
+
     // 如果没有指定保存路径，设置为默认输出目录（仅用于显示）
     if (!config->enable_save) {
         config->output_dir = "[Memory Only]";
@@ -148,7 +229,9 @@ int main(int argc, char* argv[])
     printf("V4L2 USB RAW Image Receiver (Cross-Platform PC Client)\n");
     printf("=====================================================\n");
     printf("Server: %s:%d\n", config.server_ip, config.port);
-    printf("Mode: %s\n", config.enable_save ? "File Save" : "Memory Only");
+    printf("Mode: %s\n", config.enable_save
+                             ? (config.container_mode ? "Container Capture" : "File Save")
+                             : "Memory Only");
     if (config.enable_save) {
         printf("Save path: %s\n", config.output_dir);
         printf("Save interval: every %d frame(s)\n", config.save_interval);
@@ -168,6 +251,9 @@ int main(int argc, char* argv[])
 #else
         printf("- Scalar processing (no SIMD acceleration)\n");
 #endif
+        if (config.enable_debayer) {
+            printf("- BGGR debayer to RGB888 preview: ENABLED\n");
+        }
         if (config.enable_save) {
             printf("- Output: RAW files + unpacked 16-bit files for SBGGR10\n");
         } else {
@@ -197,35 +283,117 @@ int main(int argc, char* argv[])
     signal(SIGTERM, signal_handler);
 #endif
 
+    // 打开逐帧CSV记录（如果指定）
+    if (config.csv_path && stats_csv_open(config.csv_path) < 0) {
+        cleanup_network();
+        return 1;
+    }
+
+    // 大页/NUMA分配模式需在任何池分配之前生效
+    g_hugepages_requested = config.hugepages;
+
+    // 初始化接收路径的帧缓冲池（所有模式都走该池）
+    frame_pool_init();
+
+    // 创建共享内存帧总线（如果启用发布）
+    if (config.publish) {
+        if (shm_bus_create(config.shm_name) < 0) {
+            cleanup_network();
+            frame_pool_destroy();
+            return 1;
+        }
+    }
+
     // 初始化内存池（如果启用转换）
     if (config.enable_conversion) {
         init_memory_pool();
     }
 
-    // 创建输出目录（仅在文件保存模式下）
+    // 创建输出目录并启动异步写回队列（仅在文件保存模式下）
     if (config.enable_save) {
         if (create_output_dir(config.output_dir) < 0) {
+            shm_bus_destroy();
             cleanup_network();
             cleanup_memory_pool();
+            frame_pool_destroy();
             return 1;
         }
+        if (config.container_mode) {
+            // 容器模式：追加写单个捕获文件，不经过逐帧写回队列
+            if (container_open(config.output_dir) < 0) {
+                cleanup_network();
+                cleanup_memory_pool();
+                return 1;
+            }
+        } else {
+            writeback_init(config.drop_saves);
+        }
     }
 
-    // 连接到服务器
-    sock_fd = connect_to_server(config.server_ip, config.port);
-    if (sock_fd == INVALID_SOCKET_FD) {
+    // 连接到服务器（条带模式开N条连接并在每条上声明流序号）
+    socket_t stream_socks[MAX_STRIPE_STREAMS];
+    int connected = 0;
+    for (int i = 0; i < config.streams; i++) {
+        stream_socks[i] = connect_to_server(config.server_ip, config.port);
+        if (stream_socks[i] == INVALID_SOCKET_FD) {
+            break;
+        }
+        connected++;
+        if (config.streams > 1) {
+            struct stripe_ctrl sc;
+            sc.magic = STRIPE_MAGIC;
+            sc.index = (uint32_t)i;
+            sc.count = (uint32_t)config.streams;
+            if (send(stream_socks[i], (const char*)&sc, sizeof(sc), 0) !=
+                (int)sizeof(sc)) {
+                printf("Failed to send stripe join on stream %d\n", i);
+                connected = -1;
+                break;
+            }
+        }
+        // 信用流控：授予初始窗口，之后每消费一帧补发
+        if (config.credits > 0) {
+            struct credit_ctrl cc;
+            cc.magic = CREDIT_MAGIC;
+            cc.credits = (uint32_t)config.credits;
+            if (send(stream_socks[i], (const char*)&cc, sizeof(cc), 0) !=
+                (int)sizeof(cc)) {
+                printf("Failed to send credit grant on stream %d\n", i);
+                connected = -1;
+                break;
+            }
+            if (i == 0) {
+                printf("Credit flow control: %d-frame window\n",
+                       config.credits);
+            }
+        }
+    }
+    if (connected != config.streams) {
+        for (int i = 0; i < connected; i++) {
+            close_socket(stream_socks[i]);
+        }
+        shm_bus_destroy();
         cleanup_network();
         cleanup_memory_pool();
+        frame_pool_destroy();
         return 1;
     }
+    sock_fd = stream_socks[0];
 
     // 主接收循环
-    int result = receive_loop(sock_fd, &config);
+    int result = receive_loop_striped(stream_socks, config.streams, &config);
 
-    // 清理
-    close_socket(sock_fd);
+    // 清理（写回队列先排空剩余任务，容器文件写出索引后关闭）
+    for (int i = 0; i < config.streams; i++) {
+        close_socket(stream_socks[i]);
+    }
+    writeback_destroy();
+    container_close();
+    shm_bus_destroy();
     cleanup_network();
     cleanup_memory_pool();
+    frame_pool_destroy();
+    stats_csv_close();
 
     // 打印最终统计
     print_stats();
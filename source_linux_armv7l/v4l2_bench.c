@@ -19,7 +19,7 @@
 #define BUFFER_COUNT 3
 #define FILENAME_TEMPLATE "/dev/shm/raw_%02d.BG10"
 #define WARMUP_RUNS 5
-#define MAX_RUNS 100  // 减少运行次数以避免频繁写入
+#define MAX_RUNS 500  // 足够多的样本让尾部百分位有意义
 #define SAVE_INTERVAL 10  // 每10帧保存一次，减少磁盘写入
 
 #ifndef uint64_t
@@ -30,6 +30,115 @@ typedef unsigned long long uint64_t;
 #define UINT64_MAX ((uint64_t)-1)
 #endif
 
+// 延迟统计结果（单位：毫秒）
+struct latency_stats {
+    double min_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+    double avg_ms;
+    double jitter_ms;  // 相邻两次捕获耗时之差的标准差
+};
+
+// qsort比较函数：uint64_t升序
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t va = *(const uint64_t *)a;
+    uint64_t vb = *(const uint64_t *)b;
+    return (va > vb) - (va < vb);
+}
+
+// 由原始计时样本计算min/p50/p90/p99/max/avg与帧间抖动。
+// times会被排序，调用后原始顺序不再可用。
+static void compute_latency_stats(uint64_t *times, int count,
+                                  struct latency_stats *out) {
+    memset(out, 0, sizeof(*out));
+    if (count <= 0) {
+        return;
+    }
+    
+    // 抖动要用时间顺序的相邻差值，必须在排序前计算
+    if (count >= 2) {
+        double delta_sum = 0, delta_sq_sum = 0;
+        for (int i = 1; i < count; i++) {
+            double delta = ((double)times[i] - (double)times[i - 1]) / 1e6;
+            delta_sum += delta;
+            delta_sq_sum += delta * delta;
+        }
+        double n = count - 1;
+        double mean = delta_sum / n;
+        double variance = delta_sq_sum / n - mean * mean;
+        if (variance > 0) {
+            double x = variance, prev = 0;
+            // 牛顿迭代开方，避免为一个sqrt挂上-lm
+            for (int i = 0; i < 32 && x != prev; i++) {
+                prev = x;
+                x = (x + variance / x) / 2;
+            }
+            out->jitter_ms = x;
+        }
+    }
+    
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        total += (double)times[i];
+    }
+    
+    qsort(times, count, sizeof(uint64_t), cmp_u64);
+    
+    out->min_ms = times[0] / 1e6;
+    out->p50_ms = times[count / 2] / 1e6;
+    out->p90_ms = times[(count * 90) / 100] / 1e6;
+    out->p99_ms = times[(count * 99) / 100 < count ? (count * 99) / 100
+                                                   : count - 1] / 1e6;
+    out->max_ms = times[count - 1] / 1e6;
+    out->avg_ms = total / count / 1e6;
+}
+
+// 把一轮结果以稳定schema写入JSON文件，便于归档与跨版本对比
+static int write_json_report(const char *path, const char *tool,
+                             const char *mode, const char *device,
+                             int width, int height, uint32_t pixelformat,
+                             int runs, int successful_runs,
+                             const struct latency_stats *stats) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("Failed to open JSON output file");
+        return -1;
+    }
+    
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"schema_version\": 1,\n");
+    fprintf(fp, "  \"tool\": \"%s\",\n", tool);
+    fprintf(fp, "  \"mode\": \"%s\",\n", mode);
+    fprintf(fp, "  \"device\": \"%s\",\n", device);
+    fprintf(fp, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(fp, "  \"width\": %d,\n", width);
+    fprintf(fp, "  \"height\": %d,\n", height);
+    fprintf(fp, "  \"pixelformat\": \"%c%c%c%c\",\n",
+            (char)(pixelformat >> 0), (char)(pixelformat >> 8),
+            (char)(pixelformat >> 16), (char)(pixelformat >> 24));
+    fprintf(fp, "  \"warmup_runs\": %d,\n", WARMUP_RUNS);
+    fprintf(fp, "  \"runs\": %d,\n", runs);
+    fprintf(fp, "  \"successful_runs\": %d,\n", successful_runs);
+    fprintf(fp, "  \"capture_ms\": {\n");
+    fprintf(fp, "    \"min\": %.3f,\n", stats->min_ms);
+    fprintf(fp, "    \"p50\": %.3f,\n", stats->p50_ms);
+    fprintf(fp, "    \"p90\": %.3f,\n", stats->p90_ms);
+    fprintf(fp, "    \"p99\": %.3f,\n", stats->p99_ms);
+    fprintf(fp, "    \"max\": %.3f,\n", stats->max_ms);
+    fprintf(fp, "    \"avg\": %.3f,\n", stats->avg_ms);
+    fprintf(fp, "    \"jitter_stddev\": %.3f\n", stats->jitter_ms);
+    fprintf(fp, "  },\n");
+    fprintf(fp, "  \"avg_fps\": %.2f\n",
+            stats->avg_ms > 0 ? 1000.0 / stats->avg_ms : 0.0);
+    fprintf(fp, "}\n");
+    
+    fclose(fp);
+    printf("JSON report written to %s\n", path);
+    return 0;
+}
+
 // 高精度计时函数
 static inline uint64_t get_time_ns() {
     struct timespec ts;
@@ -264,7 +373,9 @@ int capture_image(int fd, Buffer* buffers, int index, const char *filename) {
     return buf.index;
 }
 
-double benchmark_single_frame_capture(int fd) {
+double benchmark_single_frame_capture(int fd, struct latency_stats *out_stats,
+                                      int *out_success) {
+    static uint64_t times[MAX_RUNS];
     uint64_t min_ns = UINT64_MAX;
     uint64_t max_ns = 0;
     double total_ns = 0;
@@ -307,6 +418,7 @@ double benchmark_single_frame_capture(int fd) {
         if (duration < min_ns) min_ns = duration;
         if (duration > max_ns) max_ns = duration;
         total_ns += duration;
+        times[success_count] = duration;
         success_count++;
         
         // 计算当前频率
@@ -328,26 +440,52 @@ double benchmark_single_frame_capture(int fd) {
     double min_freq_hz = 1e9 / (double)min_ns;
     double max_freq_hz_calc = 1e9 / (double)max_ns;
     
+    struct latency_stats stats;
+    compute_latency_stats(times, success_count, &stats);
+    
     // 输出最终报告
     printf("\n\n=== Benchmark Results (Single Frame Mode) ===\n");
     printf("Successful runs:    %d/%d\n", success_count, MAX_RUNS);
     printf("Min execution time: %7.3f ms (%6.2f Hz)\n", (double)min_ns/1e6, min_freq_hz);
     printf("Avg execution time: %7.3f ms (%6.2f Hz)\n", avg_ns/1e6, avg_freq_hz);
     printf("Max execution time: %7.3f ms (%6.2f Hz)\n", (double)max_ns/1e6, max_freq_hz_calc);
+    printf("Percentiles:        p50=%.3f ms, p90=%.3f ms, p99=%.3f ms\n",
+           stats.p50_ms, stats.p90_ms, stats.p99_ms);
+    printf("Jitter (stddev):    %.3f ms\n", stats.jitter_ms);
     printf("Peak frequency:     %6.2f Hz\n", max_freq_hz);
     printf("Files saved:        %d (rotating in /dev/shm)\n", (save_counter + SAVE_INTERVAL - 1) / SAVE_INTERVAL);
     
+    if (out_stats) {
+        *out_stats = stats;
+    }
+    if (out_success) {
+        *out_success = success_count;
+    }
+    
     return min_freq_hz;  // 返回最高频率
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     const char *dev_name = "/dev/video0";
+    const char *json_path = NULL;
     int fd = -1;
     Buffer* buffers = NULL;
     struct v4l2_format fmt = {0};
     struct v4l2_requestbuffers req = {0};
     struct v4l2_capability cap = {0};
     int buffer_count = BUFFER_COUNT;
+    struct latency_stats bench_stats = {0};
+    int success_count = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            printf("Usage: %s [--json <file>]\n", argv[0]);
+            printf("  --json <file>  Also write results as JSON for archiving\n");
+            return EXIT_FAILURE;
+        }
+    }
     
     // 打开设备
     fd = open(dev_name, O_RDWR);
@@ -507,7 +645,8 @@ int main() {
         }
 
         // 执行基准测试
-        max_freq = benchmark_single_frame_capture(fd);
+        max_freq = benchmark_single_frame_capture(fd, &bench_stats,
+                                                  &success_count);
         
         // 停止视频流
         enum v4l2_buf_type stop_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -516,10 +655,18 @@ int main() {
     } else {
         // 使用单帧读取模式
         printf("Using single frame capture mode (read/write)\n");
-        max_freq = benchmark_single_frame_capture(fd);
+        max_freq = benchmark_single_frame_capture(fd, &bench_stats,
+                                                  &success_count);
     }
     
     printf("Maximum frequency: %.2f Hz\n", max_freq);
+    
+    if (json_path && success_count > 0) {
+        write_json_report(json_path, "v4l2_bench", "single_frame", dev_name,
+                          fmt.fmt.pix.width, fmt.fmt.pix.height,
+                          fmt.fmt.pix.pixelformat, MAX_RUNS, success_count,
+                          &bench_stats);
+    }
 
 cleanup:
     // 清理资源
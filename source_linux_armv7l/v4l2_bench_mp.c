@@ -12,15 +12,19 @@
 #include <time.h>
 #include <errno.h>
 #include <stdint.h>
+#include <sys/resource.h>
 
 #define WIDTH 2048
 #define HEIGHT 1296
 #define PIXELFORMAT V4L2_PIX_FMT_SBGGR10
 #define BUFFER_COUNT 3
+#define MAX_BUFFERS 8
 #define FILENAME_TEMPLATE "/dev/shm/raw_%02d.BG10"
 #define WARMUP_RUNS 5
-#define MAX_RUNS 100
+#define MAX_RUNS 500  // 足够多的样本让尾部百分位有意义
+#define SWEEP_RUNS 100
 #define SAVE_INTERVAL 10
+#define MAX_SWEEP_CONFIGS 64
 
 #ifndef uint64_t
 typedef unsigned long long uint64_t;
@@ -71,30 +75,35 @@ void print_format_info_mp(struct v4l2_format *fmt) {
 }
 
 // 设置多平面格式
-int set_format_mp(int fd, struct v4l2_format *fmt) {
+int set_format_mp(int fd, struct v4l2_format *fmt,
+                  int width, int height, uint32_t pixelformat, int quiet) {
     memset(fmt, 0, sizeof(*fmt));
     fmt->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    fmt->fmt.pix_mp.width = WIDTH;
-    fmt->fmt.pix_mp.height = HEIGHT;
-    fmt->fmt.pix_mp.pixelformat = PIXELFORMAT;
+    fmt->fmt.pix_mp.width = width;
+    fmt->fmt.pix_mp.height = height;
+    fmt->fmt.pix_mp.pixelformat = pixelformat;
     fmt->fmt.pix_mp.field = V4L2_FIELD_NONE;
     
-    printf("Setting multiplanar format %dx%d, pixelformat=0x%08x...\n",
-           WIDTH, HEIGHT, PIXELFORMAT);
+    if (!quiet) {
+        printf("Setting multiplanar format %dx%d, pixelformat=0x%08x...\n",
+               width, height, pixelformat);
+    }
     
     if (xioctl(fd, VIDIOC_S_FMT, fmt) == -1) {
         perror("VIDIOC_S_FMT failed");
         return -1;
     }
     
-    printf("SUCCESS! Multiplanar format set successfully!\n");
-    print_format_info_mp(fmt);
+    if (!quiet) {
+        printf("SUCCESS! Multiplanar format set successfully!\n");
+        print_format_info_mp(fmt);
+    }
     
     return 0;
 }
 
 // 申请多平面缓冲区
-int request_buffers_mp(int fd, struct buffer *buffers, int count) {
+int request_buffers_mp(int fd, struct buffer *buffers, int count, int quiet) {
     struct v4l2_requestbuffers reqbuf = {0};
     reqbuf.count = count;
     reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
@@ -105,7 +114,9 @@ int request_buffers_mp(int fd, struct buffer *buffers, int count) {
         return -1;
     }
     
-    printf("Requested %d buffers, got %d\n", count, reqbuf.count);
+    if (!quiet) {
+        printf("Requested %d buffers, got %d\n", count, reqbuf.count);
+    }
     
     for (int i = 0; i < reqbuf.count; i++) {
         struct v4l2_buffer buf = {0};
@@ -123,7 +134,9 @@ int request_buffers_mp(int fd, struct buffer *buffers, int count) {
         }
         
         buffers[i].num_planes = buf.length;
-        printf("Buffer %d has %d planes\n", i, buf.length);
+        if (!quiet) {
+            printf("Buffer %d has %d planes\n", i, buf.length);
+        }
         
         for (int p = 0; p < buf.length; p++) {
             buffers[i].length[p] = buf.m.planes[p].length;
@@ -136,8 +149,10 @@ int request_buffers_mp(int fd, struct buffer *buffers, int count) {
                 return -1;
             }
             
-            printf("  Plane %d: mapped %zu bytes at %p\n", 
-                   p, buffers[i].length[p], buffers[i].start[p]);
+            if (!quiet) {
+                printf("  Plane %d: mapped %zu bytes at %p\n", 
+                       p, buffers[i].length[p], buffers[i].start[p]);
+            }
         }
     }
     
@@ -183,7 +198,7 @@ int dequeue_buffer_mp(int fd, int *index) {
 }
 
 // 启动/停止流
-int start_streaming_mp(int fd) {
+int start_streaming_mp(int fd, int quiet) {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     
     if (xioctl(fd, VIDIOC_STREAMON, &type) == -1) {
@@ -191,11 +206,13 @@ int start_streaming_mp(int fd) {
         return -1;
     }
     
-    printf("Streaming started\n");
+    if (!quiet) {
+        printf("Streaming started\n");
+    }
     return 0;
 }
 
-int stop_streaming_mp(int fd) {
+int stop_streaming_mp(int fd, int quiet) {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     
     if (xioctl(fd, VIDIOC_STREAMOFF, &type) == -1) {
@@ -203,7 +220,9 @@ int stop_streaming_mp(int fd) {
         return -1;
     }
     
-    printf("Streaming stopped\n");
+    if (!quiet) {
+        printf("Streaming stopped\n");
+    }
     return 0;
 }
 
@@ -255,41 +274,74 @@ int check_device_caps(int fd) {
     return 0;
 }
 
-// 基准测试主函数
-int benchmark_capture_mp(int fd) {
+// 单配置基准测试结果
+struct bench_stats {
+    double min_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+    double avg_ms;
+    double jitter_ms;  // 相邻两次捕获耗时之差的标准差
+    double fps;
+    long peak_rss_kb;
+};
+
+// qsort比较函数：uint64_t升序
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t va = *(const uint64_t *)a;
+    uint64_t vb = *(const uint64_t *)b;
+    return (va > vb) - (va < vb);
+}
+
+// 基准测试主函数：对单个格式/缓冲区数组合完整跑一轮
+// REQBUFS/STREAMON周期，stats非NULL时回传统计结果
+int benchmark_capture_mp(int fd, int width, int height, uint32_t pixelformat,
+                         int buffer_count, int runs, int quiet,
+                         struct bench_stats *stats) {
     struct v4l2_format fmt;
-    struct buffer buffers[BUFFER_COUNT];
-    int buffer_count;
+    struct buffer buffers[MAX_BUFFERS];
+    int actual_buffers;
     uint64_t times[MAX_RUNS];
     int saved_count = 0;
+    int completed = 0;
+    
+    if (buffer_count > MAX_BUFFERS) {
+        buffer_count = MAX_BUFFERS;
+    }
+    if (runs > MAX_RUNS) {
+        runs = MAX_RUNS;
+    }
     
     // 设置格式
-    if (set_format_mp(fd, &fmt) < 0) {
+    if (set_format_mp(fd, &fmt, width, height, pixelformat, quiet) < 0) {
         return -1;
     }
     
     // 申请缓冲区
-    buffer_count = request_buffers_mp(fd, buffers, BUFFER_COUNT);
-    if (buffer_count < 0) {
+    actual_buffers = request_buffers_mp(fd, buffers, buffer_count, quiet);
+    if (actual_buffers < 0) {
         return -1;
     }
     
     // 队列所有缓冲区
-    for (int i = 0; i < buffer_count; i++) {
+    for (int i = 0; i < actual_buffers; i++) {
         if (queue_buffer_mp(fd, i) < 0) {
             return -1;
         }
     }
     
     // 启动流
-    if (start_streaming_mp(fd) < 0) {
+    if (start_streaming_mp(fd, quiet) < 0) {
         return -1;
     }
     
-    printf("\nStarting benchmark (warmup + %d runs)...\n", MAX_RUNS);
+    if (!quiet) {
+        printf("\nStarting benchmark (warmup + %d runs)...\n", runs);
+    }
     
     // 预热 + 基准测试
-    for (int run = -WARMUP_RUNS; run < MAX_RUNS; run++) {
+    for (int run = -WARMUP_RUNS; run < runs; run++) {
         uint64_t start_time = get_time_ns();
         
         // 等待数据可用
@@ -320,9 +372,10 @@ int benchmark_capture_mp(int fd) {
         // 记录时间（跳过预热）
         if (run >= 0) {
             times[run] = end_time - start_time;
+            completed = run + 1;
             
-            // 定期保存图像
-            if (run % SAVE_INTERVAL == 0 && saved_count < 5) {
+            // 定期保存图像（扫描模式下不保存）
+            if (!quiet && run % SAVE_INTERVAL == 0 && saved_count < 5) {
                 char filename[256];
                 snprintf(filename, sizeof(filename), FILENAME_TEMPLATE, saved_count);
                 
@@ -334,7 +387,7 @@ int benchmark_capture_mp(int fd) {
                 }
             }
             
-            if (run % 10 == 0) {
+            if (!quiet && run % 10 == 0) {
                 printf("Run %d: %.2f ms (%d bytes)\n", 
                        run, (end_time - start_time) / 1000000.0, bytes_used);
             }
@@ -347,44 +400,302 @@ int benchmark_capture_mp(int fd) {
     }
     
     // 停止流
-    stop_streaming_mp(fd);
+    stop_streaming_mp(fd, quiet);
     
-    // 统计分析
-    printf("\n=== Benchmark Results ===\n");
+    // 清理映射
+    for (int i = 0; i < actual_buffers; i++) {
+        for (int p = 0; p < buffers[i].num_planes; p++) {
+            if (buffers[i].start[p] != MAP_FAILED) {
+                munmap(buffers[i].start[p], buffers[i].length[p]);
+            }
+        }
+    }
     
+    // 释放驱动侧缓冲区，便于下一个配置重新REQBUFS
+    struct v4l2_requestbuffers reqbuf = {0};
+    reqbuf.count = 0;
+    reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    reqbuf.memory = V4L2_MEMORY_MMAP;
+    xioctl(fd, VIDIOC_REQBUFS, &reqbuf);
+    
+    if (completed < runs) {
+        printf("Benchmark aborted after %d/%d runs\n", completed, runs);
+        return -1;
+    }
+    
+    // 统计分析
     uint64_t min_time = UINT64_MAX, max_time = 0, total_time = 0;
-    for (int i = 0; i < MAX_RUNS; i++) {
+    for (int i = 0; i < runs; i++) {
         if (times[i] < min_time) min_time = times[i];
         if (times[i] > max_time) max_time = times[i];
         total_time += times[i];
     }
     
-    double avg_time = (double)total_time / MAX_RUNS;
-    double min_ms = min_time / 1000000.0;
-    double max_ms = max_time / 1000000.0;
-    double avg_ms = avg_time / 1000000.0;
-    double fps = 1000.0 / avg_ms;
+    struct bench_stats local;
+    memset(&local, 0, sizeof(local));
     
-    printf("Capture time (ms): min=%.2f, max=%.2f, avg=%.2f\n", min_ms, max_ms, avg_ms);
-    printf("Average FPS: %.2f\n", fps);
-    printf("Frames saved: %d\n", saved_count);
+    // 帧间抖动要用时间顺序的相邻差值，必须在排序前计算
+    if (runs >= 2) {
+        double delta_sum = 0, delta_sq_sum = 0;
+        for (int i = 1; i < runs; i++) {
+            double delta = ((double)times[i] - (double)times[i - 1]) / 1e6;
+            delta_sum += delta;
+            delta_sq_sum += delta * delta;
+        }
+        double n = runs - 1;
+        double mean = delta_sum / n;
+        double variance = delta_sq_sum / n - mean * mean;
+        if (variance > 0) {
+            double x = variance, prev = 0;
+            // 牛顿迭代开方，避免为一个sqrt挂上-lm
+            for (int i = 0; i < 32 && x != prev; i++) {
+                prev = x;
+                x = (x + variance / x) / 2;
+            }
+            local.jitter_ms = x;
+        }
+    }
     
-    // 清理映射
-    for (int i = 0; i < buffer_count; i++) {
-        for (int p = 0; p < buffers[i].num_planes; p++) {
-            if (buffers[i].start[p] != MAP_FAILED) {
-                munmap(buffers[i].start[p], buffers[i].length[p]);
+    qsort(times, runs, sizeof(uint64_t), cmp_u64);
+    
+    double avg_time = (double)total_time / runs;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    
+    local.min_ms = min_time / 1000000.0;
+    local.p50_ms = times[runs / 2] / 1000000.0;
+    local.p90_ms = times[(runs * 90) / 100] / 1000000.0;
+    local.p99_ms = times[(runs * 99) / 100 < runs ? (runs * 99) / 100
+                                                  : runs - 1] / 1000000.0;
+    local.max_ms = max_time / 1000000.0;
+    local.avg_ms = avg_time / 1000000.0;
+    local.fps = 1000.0 / local.avg_ms;
+    local.peak_rss_kb = ru.ru_maxrss;
+    
+    if (stats) {
+        *stats = local;
+    }
+    
+    if (!quiet) {
+        printf("\n=== Benchmark Results ===\n");
+        printf("Capture time (ms): min=%.2f, max=%.2f, avg=%.2f\n",
+               local.min_ms, local.max_ms, local.avg_ms);
+        printf("Percentiles: p50=%.2f ms, p90=%.2f ms, p99=%.2f ms\n",
+               local.p50_ms, local.p90_ms, local.p99_ms);
+        printf("Jitter (stddev): %.3f ms\n", local.jitter_ms);
+        printf("Average FPS: %.2f\n", local.fps);
+        printf("Peak RSS: %ld KB\n", local.peak_rss_kb);
+        printf("Frames saved: %d\n", saved_count);
+    }
+    
+    return 0;
+}
+
+// 向JSON报告追加一个配置的结果条目
+static void json_write_result(FILE *fp, int first, uint32_t pixelformat,
+                              int width, int height, int buffers, int runs,
+                              const struct bench_stats *stats) {
+    fprintf(fp, "%s    {\n", first ? "" : ",\n");
+    fprintf(fp, "      \"pixelformat\": \"%c%c%c%c\",\n",
+            (char)(pixelformat >> 0), (char)(pixelformat >> 8),
+            (char)(pixelformat >> 16), (char)(pixelformat >> 24));
+    fprintf(fp, "      \"width\": %d,\n", width);
+    fprintf(fp, "      \"height\": %d,\n", height);
+    fprintf(fp, "      \"buffers\": %d,\n", buffers);
+    fprintf(fp, "      \"runs\": %d,\n", runs);
+    fprintf(fp, "      \"capture_ms\": {\n");
+    fprintf(fp, "        \"min\": %.3f,\n", stats->min_ms);
+    fprintf(fp, "        \"p50\": %.3f,\n", stats->p50_ms);
+    fprintf(fp, "        \"p90\": %.3f,\n", stats->p90_ms);
+    fprintf(fp, "        \"p99\": %.3f,\n", stats->p99_ms);
+    fprintf(fp, "        \"max\": %.3f,\n", stats->max_ms);
+    fprintf(fp, "        \"avg\": %.3f,\n", stats->avg_ms);
+    fprintf(fp, "        \"jitter_stddev\": %.3f\n", stats->jitter_ms);
+    fprintf(fp, "      },\n");
+    fprintf(fp, "      \"fps\": %.2f,\n", stats->fps);
+    fprintf(fp, "      \"peak_rss_kb\": %ld\n", stats->peak_rss_kb);
+    fprintf(fp, "    }");
+}
+
+// 打开JSON报告并写入头部（结果数组由调用方逐条追加）
+static FILE *json_open_report(const char *path, const char *mode,
+                              const char *device) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("Failed to open JSON output file");
+        return NULL;
+    }
+    
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"schema_version\": 1,\n");
+    fprintf(fp, "  \"tool\": \"v4l2_bench_mp\",\n");
+    fprintf(fp, "  \"mode\": \"%s\",\n", mode);
+    fprintf(fp, "  \"device\": \"%s\",\n", device);
+    fprintf(fp, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(fp, "  \"warmup_runs\": %d,\n", WARMUP_RUNS);
+    fprintf(fp, "  \"results\": [\n");
+    return fp;
+}
+
+// 收尾JSON报告
+static void json_close_report(FILE *fp, const char *path) {
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+    printf("JSON report written to %s\n", path);
+}
+
+// 扫描配置：一个格式 + 一档分辨率
+struct sweep_config {
+    uint32_t pixelformat;
+    int width;
+    int height;
+};
+
+// 通过VIDIOC_ENUM_FMT/VIDIOC_ENUM_FRAMESIZES枚举设备支持的
+// 格式与分辨率组合（逐档离散分辨率；步进式只取最大档）
+static int enumerate_sweep_configs(int fd, struct sweep_config *configs,
+                                   int max_configs) {
+    int count = 0;
+    
+    for (int f = 0; count < max_configs; f++) {
+        struct v4l2_fmtdesc fmtdesc = {0};
+        fmtdesc.index = f;
+        fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        
+        if (xioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc) == -1) {
+            break;
+        }
+        
+        printf("Format %d: %s (0x%08x)\n", f, fmtdesc.description,
+               fmtdesc.pixelformat);
+        
+        for (int r = 0; count < max_configs; r++) {
+            struct v4l2_frmsizeenum frmsize = {0};
+            frmsize.index = r;
+            frmsize.pixel_format = fmtdesc.pixelformat;
+            
+            if (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == -1) {
+                break;
+            }
+            
+            if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                configs[count].pixelformat = fmtdesc.pixelformat;
+                configs[count].width = frmsize.discrete.width;
+                configs[count].height = frmsize.discrete.height;
+                count++;
+            } else {
+                // 步进/连续范围只测最大分辨率
+                configs[count].pixelformat = fmtdesc.pixelformat;
+                configs[count].width = frmsize.stepwise.max_width;
+                configs[count].height = frmsize.stepwise.max_height;
+                count++;
+                break;
             }
         }
     }
     
+    return count;
+}
+
+// 扫描模式：缓冲区数2..8 x 所有枚举到的格式/分辨率，
+// 每个组合重跑完整REQBUFS/STREAMON周期并输出一行结果
+int benchmark_sweep_mp(int fd, const char *device, const char *json_path) {
+    struct sweep_config configs[MAX_SWEEP_CONFIGS];
+    int num_configs = enumerate_sweep_configs(fd, configs, MAX_SWEEP_CONFIGS);
+    FILE *json_fp = NULL;
+    int json_results = 0;
+    
+    if (num_configs <= 0) {
+        printf("No multiplanar formats enumerated, falling back to %dx%d\n",
+               WIDTH, HEIGHT);
+        configs[0].pixelformat = PIXELFORMAT;
+        configs[0].width = WIDTH;
+        configs[0].height = HEIGHT;
+        num_configs = 1;
+    }
+    
+    if (json_path) {
+        json_fp = json_open_report(json_path, "sweep", device);
+    }
+    
+    printf("\nSweeping %d format(s) x buffer counts 2..%d, %d runs each\n\n",
+           num_configs, MAX_BUFFERS, SWEEP_RUNS);
+    printf("%-10s %-11s %-4s %8s %8s %8s %8s %8s %8s %8s %9s\n",
+           "format", "resolution", "bufs", "min_ms", "p50_ms", "avg_ms",
+           "p99_ms", "max_ms", "jit_ms", "fps", "rss_kb");
+    
+    for (int c = 0; c < num_configs; c++) {
+        char fourcc[5] = {
+            (char)(configs[c].pixelformat >> 0),
+            (char)(configs[c].pixelformat >> 8),
+            (char)(configs[c].pixelformat >> 16),
+            (char)(configs[c].pixelformat >> 24),
+            0
+        };
+        char resolution[16];
+        snprintf(resolution, sizeof(resolution), "%dx%d",
+                 configs[c].width, configs[c].height);
+        
+        for (int bufs = 2; bufs <= MAX_BUFFERS; bufs++) {
+            struct bench_stats stats;
+            
+            if (benchmark_capture_mp(fd, configs[c].width, configs[c].height,
+                                     configs[c].pixelformat, bufs,
+                                     SWEEP_RUNS, 1, &stats) < 0) {
+                printf("%-10s %-11s %-4d   (configuration failed)\n",
+                       fourcc, resolution, bufs);
+                continue;
+            }
+            
+            printf("%-10s %-11s %-4d %8.2f %8.2f %8.2f %8.2f %8.2f %8.3f %8.2f %9ld\n",
+                   fourcc, resolution, bufs, stats.min_ms, stats.p50_ms,
+                   stats.avg_ms, stats.p99_ms, stats.max_ms, stats.jitter_ms,
+                   stats.fps, stats.peak_rss_kb);
+            
+            if (json_fp) {
+                json_write_result(json_fp, json_results == 0,
+                                  configs[c].pixelformat, configs[c].width,
+                                  configs[c].height, bufs, SWEEP_RUNS,
+                                  &stats);
+                json_results++;
+            }
+        }
+    }
+    
+    if (json_fp) {
+        json_close_report(json_fp, json_path);
+    }
+    
+    printf("\nPick the smallest buffer count whose p99 stops improving and\n");
+    printf("feed it to the streamer's -b flag.\n");
+    
     return 0;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     const char *device = "/dev/video0";
+    const char *json_path = NULL;
+    int sweep = 0;
     int fd;
     
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0) {
+            sweep = 1;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            printf("Usage: %s [-s] [-d device] [--json <file>]\n", argv[0]);
+            printf("  -s             Sweep buffer counts 2..%d and all\n",
+                   MAX_BUFFERS);
+            printf("                 enumerated formats/resolutions\n");
+            printf("  -d device      V4L2 device (default: /dev/video0)\n");
+            printf("  --json <file>  Also write results as JSON\n");
+            return 1;
+        }
+    }
+    
     printf("V4L2 Multiplanar Benchmark Tool for Luckfox Pico Mini B\n");
     printf("========================================================\n");
     
@@ -404,7 +715,22 @@ int main() {
     }
     
     // 运行基准测试
-    int result = benchmark_capture_mp(fd);
+    int result;
+    if (sweep) {
+        result = benchmark_sweep_mp(fd, device, json_path);
+    } else {
+        struct bench_stats stats;
+        result = benchmark_capture_mp(fd, WIDTH, HEIGHT, PIXELFORMAT,
+                                      BUFFER_COUNT, MAX_RUNS, 0, &stats);
+        if (result == 0 && json_path) {
+            FILE *json_fp = json_open_report(json_path, "single", device);
+            if (json_fp) {
+                json_write_result(json_fp, 1, PIXELFORMAT, WIDTH, HEIGHT,
+                                  BUFFER_COUNT, MAX_RUNS, &stats);
+                json_close_report(json_fp, json_path);
+            }
+        }
+    }
     
     close(fd);
     
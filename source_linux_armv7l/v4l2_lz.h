@@ -0,0 +1,55 @@
+/**
+ * @file v4l2_lz.h
+ * @brief 帧数据LZ4块格式压缩/解压接口
+ *
+ * 实现LZ4块格式（token + 字面量 + 2字节偏移回溯匹配）的
+ * 无依赖压缩器与解压器，用于在网络受限的RNDIS链路上
+ * 压缩RAW Bayer帧。静态场景帧压缩比高，瓶颈在网络而非CPU，
+ * 因此在设备端以计算换带宽是划算的。
+ *
+ * @author Development Team
+ * @date 2025-06-25
+ * @version 1.0
+ */
+
+#ifndef V4L2_LZ_H
+#define V4L2_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 计算压缩输出缓冲区的最坏情况大小
+ *
+ * @param size 输入数据大小
+ * @return 能容纳任意输入压缩结果的缓冲区大小
+ */
+size_t lz_compress_bound(size_t size);
+
+/**
+ * @brief 压缩一块数据（LZ4块格式）
+ *
+ * 贪心匹配 + 4字节哈希表，偏向速度而非极限压缩比。
+ *
+ * @param src 输入数据
+ * @param src_len 输入数据大小
+ * @param dst 输出缓冲区
+ * @param dst_cap 输出缓冲区容量（建议lz_compress_bound(src_len)）
+ * @return 压缩后的字节数，输出缓冲区不足返回0
+ */
+size_t lz_compress(const uint8_t* src, size_t src_len,
+                   uint8_t* dst, size_t dst_cap);
+
+/**
+ * @brief 解压一块LZ4块格式数据
+ *
+ * @param src 压缩数据
+ * @param src_len 压缩数据大小
+ * @param dst 输出缓冲区
+ * @param dst_cap 输出缓冲区容量
+ * @return 解压后的字节数，数据损坏或缓冲区不足返回-1
+ */
+int lz_decompress(const uint8_t* src, size_t src_len,
+                  uint8_t* dst, size_t dst_cap);
+
+#endif  // V4L2_LZ_H
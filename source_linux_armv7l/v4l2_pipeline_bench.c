@@ -0,0 +1,558 @@
+// V4L2端到端流水线基准测试：捕获 -> 可选8位压扩 -> 网络发送
+//
+// v4l2_bench_mp只测select+DQBUF，预测不了实际部署的推流FPS。
+// 本工具驱动完整路径：多平面捕获、可选NEON压扩、按v4l2_usb的
+// frame_header协议发送到一个sink客户端（nc即可），输出各阶段
+// 耗时占比与持续FPS/MB/s，用来判断该在压缩、ROI还是链路上投入。
+//
+// 用法示例（PC侧先跑 nc <device-ip> 8889 > /dev/null）：
+//   ./v4l2_pipeline_bench -n 300 -8
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <linux/videodev2.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define WIDTH 2048
+#define HEIGHT 1296
+#define PIXELFORMAT V4L2_PIX_FMT_SBGGR10
+#define BUFFER_COUNT 3
+#define MAX_BUFFERS 8
+#define WARMUP_RUNS 5
+#define MAX_RUNS 1000
+#define DEFAULT_RUNS 300
+#define DEFAULT_PORT 8889
+
+// 多平面缓冲区结构
+struct buffer {
+    void *start[VIDEO_MAX_PLANES];
+    size_t length[VIDEO_MAX_PLANES];
+    int num_planes;
+};
+
+// 数据帧头部结构（与v4l2_usb.c的传输协议保持一致）
+struct frame_header {
+    uint32_t magic;       // 魔数标识：0xDEADBEEF
+    uint32_t frame_id;    // 帧序号
+    uint32_t width;       // 图像宽度
+    uint32_t height;      // 图像高度
+    uint32_t pixfmt;      // 像素格式
+    uint32_t size;        // 数据大小
+    uint64_t timestamp;   // 时间戳
+    uint32_t reserved[2]; // 保留字段
+} __attribute__((packed));
+
+// 高精度计时函数
+static inline uint64_t get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int xioctl(int fd, int request, void *arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (-1 == r && EINTR == errno);
+    return r;
+}
+
+// ========================== 8位压扩 ==========================
+// 与v4l2_usb.c的预览压扩实现保持一致（工具独立编译，无法共享
+// 翻译单元），修改内核时两处需同步。
+
+// SBGGR10压扩为8位（标量版本）：每5字节4像素，取各像素高8位
+static void compand_sbggr10_to8_scalar(const uint8_t *src, uint8_t *dst,
+                                       size_t num_groups) {
+    for (size_t g = 0; g < num_groups; g++) {
+        const uint8_t *b = src + g * 5;
+        uint8_t *p = dst + g * 4;
+
+        p[0] = (uint8_t)((b[0] >> 2) | (b[1] << 6));
+        p[1] = (uint8_t)((b[1] >> 4) | (b[2] << 4));
+        p[2] = (uint8_t)((b[2] >> 6) | (b[3] << 2));
+        p[3] = b[4];
+    }
+}
+
+#ifdef __ARM_NEON
+// SBGGR10压扩为8位（NEON版本）：每迭代8组（40字节入、32像素出），
+// vtbl收集5字节步长的b0..b4，移位或合成4个像素平面后vst4交织写出
+static void compand_sbggr10_to8_neon(const uint8_t *src, uint8_t *dst,
+                                     size_t num_groups) {
+    static const uint8_t idx_base[8] = {0, 5, 10, 15, 20, 25, 30, 35};
+
+    size_t g = 0;
+
+    for (; g + 8 <= num_groups; g += 8) {
+        const uint8_t *in = src + g * 5;
+
+        uint8x8x4_t tab0 = {{vld1_u8(in),
+                             vld1_u8(in + 8),
+                             vld1_u8(in + 16),
+                             vld1_u8(in + 24)}};
+        uint8x8_t tab1 = vld1_u8(in + 32);
+
+        uint8x8_t base = vld1_u8(idx_base);
+        uint8x8_t b[5];
+
+        for (int k = 0; k < 5; k++) {
+            uint8x8_t idx0 = vadd_u8(base, vdup_n_u8(k));
+            uint8x8_t idx1 = vsub_u8(idx0, vdup_n_u8(32));
+            b[k] = vorr_u8(vtbl4_u8(tab0, idx0), vtbl1_u8(tab1, idx1));
+        }
+
+        uint8x8x4_t out;
+        out.val[0] = vorr_u8(vshr_n_u8(b[0], 2), vshl_n_u8(b[1], 6));
+        out.val[1] = vorr_u8(vshr_n_u8(b[1], 4), vshl_n_u8(b[2], 4));
+        out.val[2] = vorr_u8(vshr_n_u8(b[2], 6), vshl_n_u8(b[3], 2));
+        out.val[3] = b[4];
+
+        vst4_u8(dst + g * 4, out);
+    }
+
+    if (g < num_groups) {
+        compand_sbggr10_to8_scalar(src + g * 5, dst + g * 4, num_groups - g);
+    }
+}
+#endif
+
+// SBGGR10压扩为8位（自动选择最优实现），返回输出大小
+static size_t compand_sbggr10_to8(const uint8_t *src, uint8_t *dst,
+                                  size_t raw_size) {
+    size_t num_groups = raw_size / 5;
+
+#ifdef __ARM_NEON
+    compand_sbggr10_to8_neon(src, dst, num_groups);
+#else
+    compand_sbggr10_to8_scalar(src, dst, num_groups);
+#endif
+
+    return num_groups * 4;
+}
+
+// ========================== 多平面捕获 ==========================
+
+// 设置多平面格式
+static int set_format_mp(int fd, struct v4l2_format *fmt) {
+    memset(fmt, 0, sizeof(*fmt));
+    fmt->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    fmt->fmt.pix_mp.width = WIDTH;
+    fmt->fmt.pix_mp.height = HEIGHT;
+    fmt->fmt.pix_mp.pixelformat = PIXELFORMAT;
+    fmt->fmt.pix_mp.field = V4L2_FIELD_NONE;
+
+    if (xioctl(fd, VIDIOC_S_FMT, fmt) == -1) {
+        perror("VIDIOC_S_FMT failed");
+        return -1;
+    }
+
+    printf("Format: %dx%d, sizeimage=%d\n",
+           fmt->fmt.pix_mp.width, fmt->fmt.pix_mp.height,
+           fmt->fmt.pix_mp.plane_fmt[0].sizeimage);
+    return 0;
+}
+
+// 申请并映射多平面缓冲区
+static int request_buffers_mp(int fd, struct buffer *buffers, int count) {
+    struct v4l2_requestbuffers reqbuf = {0};
+    reqbuf.count = count;
+    reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    reqbuf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(fd, VIDIOC_REQBUFS, &reqbuf) == -1) {
+        perror("VIDIOC_REQBUFS failed");
+        return -1;
+    }
+
+    printf("Requested %d buffers, got %d\n", count, reqbuf.count);
+
+    for (int i = 0; i < reqbuf.count; i++) {
+        struct v4l2_buffer buf = {0};
+        struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        buf.m.planes = planes;
+        buf.length = VIDEO_MAX_PLANES;
+
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            perror("VIDIOC_QUERYBUF failed");
+            return -1;
+        }
+
+        buffers[i].num_planes = buf.length;
+
+        for (int p = 0; p < buf.length; p++) {
+            buffers[i].length[p] = buf.m.planes[p].length;
+            buffers[i].start[p] = mmap(NULL, buf.m.planes[p].length,
+                                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                                       fd, buf.m.planes[p].m.mem_offset);
+
+            if (MAP_FAILED == buffers[i].start[p]) {
+                perror("mmap failed");
+                return -1;
+            }
+        }
+    }
+
+    return reqbuf.count;
+}
+
+// 队列缓冲区
+static int queue_buffer_mp(int fd, int index) {
+    struct v4l2_buffer buf = {0};
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.m.planes = planes;
+    buf.length = VIDEO_MAX_PLANES;
+
+    if (xioctl(fd, VIDIOC_QBUF, &buf) == -1) {
+        perror("VIDIOC_QBUF failed");
+        return -1;
+    }
+
+    return 0;
+}
+
+// 出队缓冲区
+static int dequeue_buffer_mp(int fd, int *index) {
+    struct v4l2_buffer buf = {0};
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.m.planes = planes;
+    buf.length = VIDEO_MAX_PLANES;
+
+    if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
+        perror("VIDIOC_DQBUF failed");
+        return -1;
+    }
+
+    *index = buf.index;
+    return buf.m.planes[0].bytesused;
+}
+
+// ========================== 网络发送 ==========================
+
+// 监听并等待一个sink客户端连接
+static int wait_for_sink(int port) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket failed");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 1) < 0) {
+        perror("bind/listen failed");
+        close(listen_fd);
+        return -1;
+    }
+
+    printf("Waiting for sink client on port %d (e.g. nc <ip> %d > /dev/null)...\n",
+           port, port);
+
+    int client_fd = accept(listen_fd, NULL, NULL);
+    close(listen_fd);
+    if (client_fd < 0) {
+        perror("accept failed");
+        return -1;
+    }
+
+    int nodelay = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay,
+               sizeof(nodelay));
+
+    printf("Sink client connected\n");
+    return client_fd;
+}
+
+// 完整发送缓冲区
+static int send_full(int fd, const void *data, size_t size) {
+    const uint8_t *p = data;
+    size_t sent = 0;
+
+    while (sent < size) {
+        ssize_t n = send(fd, p + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+
+    return 0;
+}
+
+// ========================== 流水线基准测试 ==========================
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("  -d device   V4L2 device (default: /dev/video0)\n");
+    printf("  -p port     Sink listen port (default: %d)\n", DEFAULT_PORT);
+    printf("  -b num      Buffer count, 2-%d (default: %d)\n",
+           MAX_BUFFERS, BUFFER_COUNT);
+    printf("  -n num      Frames to stream, up to %d (default: %d)\n",
+           MAX_RUNS, DEFAULT_RUNS);
+    printf("  -8          Compand SBGGR10 to 8-bit before sending\n");
+    printf("  -h          Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *device = "/dev/video0";
+    int port = DEFAULT_PORT;
+    int buffer_count = BUFFER_COUNT;
+    int runs = DEFAULT_RUNS;
+    int compand = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            buffer_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-8") == 0) {
+            compand = 1;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+
+    if (buffer_count < 2 || buffer_count > MAX_BUFFERS ||
+        runs < 1 || runs > MAX_RUNS) {
+        printf("Invalid buffer count or run count\n");
+        return 1;
+    }
+
+    printf("V4L2 End-to-End Pipeline Benchmark\n");
+    printf("===================================\n");
+    printf("Device: %s, buffers: %d, frames: %d, companding: %s\n",
+           device, buffer_count, runs, compand ? "8-bit NEON" : "off");
+
+    int fd = open(device, O_RDWR | O_NONBLOCK);
+    if (fd == -1) {
+        perror("Failed to open device");
+        return 1;
+    }
+
+    struct v4l2_format fmt;
+    struct buffer buffers[MAX_BUFFERS];
+    memset(buffers, 0, sizeof(buffers));
+
+    if (set_format_mp(fd, &fmt) < 0) {
+        close(fd);
+        return 1;
+    }
+
+    int actual_buffers = request_buffers_mp(fd, buffers, buffer_count);
+    if (actual_buffers < 0) {
+        close(fd);
+        return 1;
+    }
+
+    for (int i = 0; i < actual_buffers; i++) {
+        if (queue_buffer_mp(fd, i) < 0) {
+            close(fd);
+            return 1;
+        }
+    }
+
+    // 压扩输出缓冲区（原始大小的4/5）
+    uint8_t *compand_buffer = NULL;
+    size_t max_frame = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+    if (compand) {
+        compand_buffer = malloc(max_frame / 5 * 4);
+        if (!compand_buffer) {
+            printf("Failed to allocate companding buffer\n");
+            close(fd);
+            return 1;
+        }
+    }
+
+    // 等sink连上再开流，避免空跑
+    int sink_fd = wait_for_sink(port);
+    if (sink_fd < 0) {
+        free(compand_buffer);
+        close(fd);
+        return 1;
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1) {
+        perror("VIDIOC_STREAMON failed");
+        close(sink_fd);
+        free(compand_buffer);
+        close(fd);
+        return 1;
+    }
+
+    printf("\nStreaming %d frames (warmup: %d)...\n", runs, WARMUP_RUNS);
+
+    // 各阶段累计耗时
+    uint64_t capture_ns = 0, compand_ns = 0, send_ns = 0;
+    uint64_t wire_bytes = 0;
+    int completed = 0;
+    uint64_t bench_start = 0;
+
+    for (int run = -WARMUP_RUNS; run < runs; run++) {
+        if (run == 0) {
+            bench_start = get_time_ns();
+        }
+
+        uint64_t t0 = get_time_ns();
+
+        // 阶段1：捕获（select等待 + DQBUF）
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        struct timeval tv = {.tv_sec = 2, .tv_usec = 0};
+
+        int r = select(fd + 1, &fds, NULL, NULL, &tv);
+        if (r <= 0) {
+            printf("select timeout or error on run %d\n", run);
+            break;
+        }
+
+        int buf_index;
+        int bytes_used = dequeue_buffer_mp(fd, &buf_index);
+        if (bytes_used < 0) {
+            break;
+        }
+
+        uint64_t t1 = get_time_ns();
+
+        // 阶段2：可选8位压扩
+        const uint8_t *payload = buffers[buf_index].start[0];
+        size_t payload_size = bytes_used;
+        if (compand) {
+            payload_size = compand_sbggr10_to8(payload, compand_buffer,
+                                               bytes_used);
+            payload = compand_buffer;
+        }
+
+        uint64_t t2 = get_time_ns();
+
+        // 阶段3：协议帧发送
+        struct frame_header header = {
+            .magic = 0xDEADBEEF,
+            .frame_id = (uint32_t)(run < 0 ? 0 : run),
+            .width = fmt.fmt.pix_mp.width,
+            .height = fmt.fmt.pix_mp.height,
+            .pixfmt = compand ? V4L2_PIX_FMT_SBGGR8 : fmt.fmt.pix_mp.pixelformat,
+            .size = (uint32_t)payload_size,
+            .timestamp = t0,
+            .reserved = {0, 0}
+        };
+
+        if (send_full(sink_fd, &header, sizeof(header)) < 0 ||
+            send_full(sink_fd, payload, payload_size) < 0) {
+            printf("Sink disconnected on run %d\n", run);
+            queue_buffer_mp(fd, buf_index);
+            break;
+        }
+
+        uint64_t t3 = get_time_ns();
+
+        if (run >= 0) {
+            capture_ns += t1 - t0;
+            compand_ns += t2 - t1;
+            send_ns += t3 - t2;
+            wire_bytes += sizeof(header) + payload_size;
+            completed++;
+        }
+
+        if (queue_buffer_mp(fd, buf_index) < 0) {
+            break;
+        }
+    }
+
+    uint64_t total_ns = completed > 0 ? get_time_ns() - bench_start : 1;
+
+    ioctl(fd, VIDIOC_STREAMOFF, &type);
+    close(sink_fd);
+
+    // 结果报告：各阶段耗时占比与持续吞吐
+    printf("\n=== Pipeline Benchmark Results ===\n");
+    printf("Frames streamed: %d/%d\n", completed, runs);
+
+    if (completed > 0) {
+        uint64_t stage_ns = capture_ns + compand_ns + send_ns;
+        double total_sec = total_ns / 1e9;
+
+        printf("Stage breakdown (avg per frame, share of pipeline):\n");
+        printf("  capture:  %7.2f ms (%5.1f%%)\n",
+               capture_ns / 1e6 / completed,
+               100.0 * capture_ns / stage_ns);
+        printf("  compand:  %7.2f ms (%5.1f%%)\n",
+               compand_ns / 1e6 / completed,
+               100.0 * compand_ns / stage_ns);
+        printf("  send:     %7.2f ms (%5.1f%%)\n",
+               send_ns / 1e6 / completed,
+               100.0 * send_ns / stage_ns);
+        printf("Sustained FPS: %.2f\n", completed / total_sec);
+        printf("Wire throughput: %.2f MB/s (%llu bytes)\n",
+               wire_bytes / 1024.0 / 1024.0 / total_sec,
+               (unsigned long long)wire_bytes);
+        printf("Note: capture includes waiting for the sensor; if send\n");
+        printf("dominates, invest in the link or companding; if compand\n");
+        printf("dominates, invest in the kernel or ROI mode.\n");
+    }
+
+    // 清理映射与驱动侧缓冲区
+    for (int i = 0; i < actual_buffers; i++) {
+        for (int p = 0; p < buffers[i].num_planes; p++) {
+            if (buffers[i].start[p] && buffers[i].start[p] != MAP_FAILED) {
+                munmap(buffers[i].start[p], buffers[i].length[p]);
+            }
+        }
+    }
+
+    struct v4l2_requestbuffers reqbuf = {0};
+    reqbuf.count = 0;
+    reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    reqbuf.memory = V4L2_MEMORY_MMAP;
+    xioctl(fd, VIDIOC_REQBUFS, &reqbuf);
+
+    free(compand_buffer);
+    close(fd);
+
+    return completed == runs ? 0 : 1;
+}
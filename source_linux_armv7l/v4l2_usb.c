@@ -19,9 +19,13 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <linux/videodev2.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -33,9 +37,19 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#endif
+
+#include "v4l2_lz.h"
+
 // ========================== 系统配置常量 ==========================
 
 /** @brief 图像宽度，单位：像素 */
@@ -47,8 +61,17 @@
 /** @brief 像素格式：10位BGGR原始数据格式 */
 #define PIXELFORMAT V4L2_PIX_FMT_SBGGR10
 
-/** @brief V4L2缓冲区数量，减少内存占用 */
-#define BUFFER_COUNT 3  // 减少缓冲区数量
+/** @brief V4L2缓冲区默认数量，需为租借机制预留备用缓冲区 */
+#define DEFAULT_BUFFER_COUNT 6
+
+/** @brief V4L2缓冲区最大数量 */
+#define MAX_BUFFER_COUNT 16
+
+/** @brief 帧环形队列默认深度（必须为2的幂） */
+#define DEFAULT_RING_DEPTH 8
+
+/** @brief 帧环形队列最大深度（必须为2的幂） */
+#define MAX_RING_DEPTH 64
 
 // ========================== USB传输配置 ==========================
 
@@ -64,6 +87,64 @@
 /** @brief 网络传输分块大小，64KB以提高网络效率 */
 #define CHUNK_SIZE 65536  // 恢复为64KB以提高网络效率
 
+/** @brief 零拷贝发送完成事件的最大等待时间，单位：毫秒 */
+#define ZEROCOPY_REAP_TIMEOUT_MS 5
+
+/** @brief 最大并发客户端数量 */
+#define MAX_CLIENTS 4
+
+/** @brief 每客户端发送队列深度（帧数，queue-all策略的水位上限） */
+#define CLIENT_QUEUE_DEPTH 8
+
+/** @brief 丢帧策略：排队到高水位后滞回丢弃（录制场景，默认） */
+#define DROP_POLICY_QUEUE_ALL 0
+
+/** @brief 丢帧策略：只保留最新帧（实时预览场景） */
+#define DROP_POLICY_LATEST_ONLY 1
+
+/** @brief 丢帧策略：队列满时丢最旧的未发送帧 */
+#define DROP_POLICY_OLDEST 2
+
+/** @brief 客户端控制消息魔数 */
+#define CTRL_MAGIC 0xC0DEC0DE
+
+/** @brief 条带流加入消息魔数 */
+#define STRIPE_MAGIC 0xC0DE5721
+
+/** @brief 信用流控消息魔数 */
+#define CREDIT_MAGIC 0xC0DEC4ED
+
+/** @brief 格式协商消息魔数 */
+#define FMT_MAGIC 0xF047F047
+
+/** @brief 等待格式协商连接的超时时间（毫秒） */
+#define NEGOTIATE_TIMEOUT_MS 10000
+
+/** @brief 流模式：原始10位SBGGR10数据 */
+#define STREAM_MODE_RAW10 0
+
+/** @brief 流模式：压扩为8位的预览数据（带宽减半） */
+#define STREAM_MODE_PREVIEW8 1
+
+/** @brief 压缩输出缓冲区池大小 */
+#define COMP_POOL_COUNT 4
+
+/** @brief 压缩收益门限：压缩后大小超过原始的7/8即视为不划算 */
+#define COMP_GATE_NUM 7
+#define COMP_GATE_DEN 8
+
+/** @brief 压缩收益不足时跳过压缩的帧数（自动旁路窗口） */
+#define COMP_BYPASS_FRAMES 30
+
+/** @brief DMABUF导出信息魔数 */
+#define DMABUF_MAGIC 0xDABFDABF
+
+/** @brief 延迟直方图桶数量（微秒值的log2分桶） */
+#define HIST_BUCKETS 32
+
+/** @brief 采集线程默认SCHED_FIFO优先级 */
+#define DEFAULT_RT_PRIO 50
+
 // ========================== 数据结构定义 ==========================
 
 /**
@@ -92,6 +173,44 @@ struct frame_data
     size_t size;        /**< 图像数据大小，单位：字节 */
     uint32_t frame_id;  /**< 帧序号，用于跟踪和调试 */
     uint64_t timestamp; /**< 时间戳，单位：纳秒 */
+    int buf_index;      /**< 所属V4L2缓冲区或压缩池槽位索引 */
+    int compressed;     /**< 非0表示data指向LZ压缩后的池缓冲区 */
+};
+
+/**
+ * @struct buffer_lease
+ * @brief V4L2缓冲区租借管理器
+ *
+ * DQBUF取出的缓冲区在交给发送线程后不会立即重新入队，
+ * 而是保持"租借"状态，直到发送完成才归还给驱动——
+ * 避免驱动在send()尚未读完mmap内存时覆盖数据造成撕裂帧。
+ * 归还通过位图异步完成：发送线程只置位并写eventfd唤醒，
+ * 所有QBUF ioctl仍然只由采集线程执行。
+ */
+struct buffer_lease
+{
+    uint32_t pending_release; /**< 待归还缓冲区位图（原子访问） */
+    int event_fd;             /**< 归还通知eventfd，唤醒采集线程 */
+};
+
+/**
+ * @struct frame_ring
+ * @brief 单生产者/单消费者无锁帧环形队列
+ *
+ * 采集线程（生产者）入队帧描述符，发送线程（消费者）出队。
+ * head仅由生产者修改，tail仅由消费者修改，通过acquire/release
+ * 内存序保证帧数据在索引可见之前已写入完成，因此无需互斥锁，
+ * 采集路径永远不会因为发送阻塞而等待。
+ */
+struct frame_ring
+{
+    struct frame_data slots[MAX_RING_DEPTH]; /**< 帧描述符槽位 */
+    uint32_t depth;                          /**< 队列深度（2的幂） */
+    uint32_t head;                           /**< 生产者写入位置 */
+    uint32_t tail;                           /**< 消费者读取位置 */
+    uint64_t produced;                       /**< 成功入队的帧总数 */
+    uint64_t consumed;                       /**< 成功出队的帧总数 */
+    uint64_t dropped;                        /**< 因队列满丢弃的帧总数 */
 };
 
 // ========================== 全局变量 ==========================
@@ -99,548 +218,2578 @@ struct frame_data
 /** @brief 程序运行状态标志，0表示停止，1表示运行 */
 volatile int running = 1;
 
-/** @brief 客户端连接状态，0表示未连接，1表示已连接 */
-volatile int client_connected = 0;
+/** @brief 当前已连接的客户端数量（发送线程维护，采集线程只读） */
+volatile int clients_active = 0;
 
 /** @brief TCP服务器文件描述符 */
 int server_fd = -1;
 
-/** @brief 客户端连接文件描述符 */
-int client_fd = -1;
+/** @brief 是否请求MSG_ZEROCOPY发送模式（-z标志） */
+int zerocopy_requested = 0;
 
-/** @brief 帧数据访问互斥锁，保护current_frame的并发访问 */
-pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** @brief 丢帧策略（-P标志），DROP_POLICY_* */
+int drop_policy = DROP_POLICY_QUEUE_ALL;
 
-/** @brief 帧准备就绪条件变量，用于线程间同步 */
-pthread_cond_t frame_ready = PTHREAD_COND_INITIALIZER;
+/** @brief 运行时生效的输出宽度（可经格式协商修改） */
+uint32_t g_width = WIDTH;
 
-/** @brief 当前帧数据，在采集线程和发送线程间共享 */
-struct frame_data current_frame = {0};
+/** @brief 运行时生效的输出高度（可经格式协商修改） */
+uint32_t g_height = HEIGHT;
 
-// ========================== 工具函数 ==========================
+/** @brief 是否在流启动前等待格式协商连接（-n标志） */
+int negotiate_requested = 0;
+
+/** @brief 客户端请求的ROI裁剪区域，roi_requested非0时生效 */
+struct v4l2_rect roi_rect = {0};
+
+/** @brief 是否请求了ROI裁剪 */
+int roi_requested = 0;
+
+/** @brief 是否启用实时调度（--no-rt关闭） */
+int rt_enabled = 1;
+
+/** @brief 采集线程SCHED_FIFO优先级（--rt-prio设置） */
+int rt_prio = DEFAULT_RT_PRIO;
+
+/** @brief queue-all策略高水位：队列达到该深度后开始丢帧 */
+int wm_high = CLIENT_QUEUE_DEPTH;
+
+/** @brief queue-all策略低水位：队列降到该深度后恢复排队 */
+int wm_low = CLIENT_QUEUE_DEPTH - 1;
+
+/** @brief 新帧到达通知eventfd，采集线程写入、发送线程epoll等待 */
+int frame_event_fd = -1;
+
+/** @brief 采集线程与发送线程之间的帧环形队列 */
+struct frame_ring frame_queue = {0};
+
+/** @brief V4L2缓冲区租借管理器 */
+struct buffer_lease lease_mgr = {.pending_release = 0, .event_fd = -1};
+
+// ========================== 缓冲区租借操作 ==========================
+
+int queue_buffer_mp(int fd, int index);  // 前向声明，归还时使用
 
 /**
- * @brief 获取高精度时间戳
+ * @brief 归还租借的缓冲区（供发送线程调用）
  *
- * 使用CLOCK_MONOTONIC时钟获取纳秒级别的时间戳，
- * 该时钟不受系统时间调整影响，适合性能测量。
+ * 仅在位图中置位并通过eventfd唤醒采集线程，
+ * 实际的VIDIOC_QBUF由采集线程统一执行。
  *
- * @return 返回纳秒级时间戳
+ * @param buf_index 要归还的缓冲区索引
  */
-static inline uint64_t get_time_ns()
+void lease_release(int buf_index)
 {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    __atomic_fetch_or(&lease_mgr.pending_release,
+                      1u << buf_index,
+                      __ATOMIC_RELEASE);
+
+    if (lease_mgr.event_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t n    = write(lease_mgr.event_fd, &one, sizeof(one));
+        (void)n;
+    }
 }
 
 /**
- * @brief 系统信号处理函数
+ * @brief 将所有待归还缓冲区重新加入V4L2队列（供采集线程调用）
  *
- * 处理SIGINT、SIGTERM等信号，实现程序的优雅退出。
- * 会强制关闭所有阻塞的系统调用，并通知所有等待的线程。
- *
- * @param sig 接收到的信号编号
+ * @param fd 摄像头设备文件描述符
+ * @return 归还的缓冲区数量
  */
-void signal_handler(int sig)
+int lease_requeue_pending(int fd)
 {
-    printf("\nReceived signal %d, shutting down...\n", sig);
-    running = 0;
-
-    // 强制关闭服务器socket，打断accept()阻塞
-    if (server_fd >= 0)
-    {
-        shutdown(server_fd, SHUT_RDWR);
-    }
+    uint32_t pending =
+        __atomic_exchange_n(&lease_mgr.pending_release, 0, __ATOMIC_ACQUIRE);
+    int requeued = 0;
 
-    // 关闭客户端连接，打断发送阻塞
-    if (client_fd >= 0)
+    for (int i = 0; pending != 0; i++, pending >>= 1)
     {
-        shutdown(client_fd, SHUT_RDWR);
+        if (pending & 1)
+        {
+            if (queue_buffer_mp(fd, i) < 0)
+            {
+                perror("lease requeue failed");
+            }
+            else
+            {
+                requeued++;
+            }
+        }
     }
 
-    // 通知条件变量，唤醒等待的线程
-    pthread_mutex_lock(&frame_mutex);
-    pthread_cond_broadcast(&frame_ready);
-    pthread_mutex_unlock(&frame_mutex);
+    return requeued;
 }
 
+// ========================== 帧环形队列操作 ==========================
+
 /**
- * @brief V4L2 ioctl系统调用包装函数
+ * @brief 初始化帧环形队列
  *
- * 提供带重试机制的ioctl调用，自动处理EINTR信号中断。
- * 这是V4L2编程的标准做法，确保系统调用的可靠性。
+ * 深度会被向上取整为2的幂并限制在[2, MAX_RING_DEPTH]范围内，
+ * 以便用位掩码代替取模运算。
  *
- * @param fd 文件描述符
- * @param request ioctl请求代码
- * @param arg 请求参数指针
- * @return 成功返回0，失败返回-1
+ * @param ring 环形队列指针
+ * @param depth 请求的队列深度
  */
-int xioctl(int fd, int request, void* arg)
+void ring_init(struct frame_ring* ring, uint32_t depth)
 {
-    int r;
-    do
+    uint32_t d = 2;
+    while (d < depth && d < MAX_RING_DEPTH)
     {
-        r = ioctl(fd, request, arg);
-    } while (-1 == r && EINTR == errno);
-    return r;
-}
+        d <<= 1;
+    }
 
-// ========================== V4L2设备管理函数 ==========================
+    memset(ring, 0, sizeof(*ring));
+    ring->depth = d;
+}
 
 /**
- * @brief 检查V4L2设备能力
+ * @brief 帧入队（仅供采集线程调用）
  *
- * 查询摄像头设备的基本信息和支持的功能，确保设备支持：
- * - 多平面视频采集 (V4L2_CAP_VIDEO_CAPTURE_MPLANE)
- * - 流式传输 (V4L2_CAP_STREAMING)
+ * 无锁操作：队列满时立即返回失败并累加丢弃计数，
+ * 采集线程因此永远不会被发送线程拖慢。
  *
- * @param fd 摄像头设备文件描述符
- * @return 成功返回0，失败返回-1
+ * @param ring 环形队列指针
+ * @param frame 待入队的帧描述符
+ * @return 成功返回0，队列满返回-1
  */
-int check_device_caps(int fd)
+int ring_push(struct frame_ring* ring, const struct frame_data* frame)
 {
-    struct v4l2_capability cap = {0};
-
-    if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == -1)
-    {
-        perror("VIDIOC_QUERYCAP failed");
-        return -1;
-    }
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
 
-    printf("Device: %s\n", cap.card);
-    printf("Driver: %s\n", cap.driver);
-
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE))
-    {
-        printf("Device does not support multiplanar video capture\n");
-        return -1;
-    }
-
-    if (!(cap.capabilities & V4L2_CAP_STREAMING))
+    if (head - tail >= ring->depth)
     {
-        printf("Device does not support streaming\n");
+        ring->dropped++;
         return -1;
     }
 
-    printf("Device supports multiplanar streaming capture\n");
+    ring->slots[head & (ring->depth - 1)] = *frame;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    ring->produced++;
     return 0;
 }
 
 /**
- * @brief 设置V4L2多平面视频格式
- *
- * 配置摄像头的输出格式，包括分辨率、像素格式等参数。
- * 使用多平面格式以支持更灵活的内存管理。
+ * @brief 帧出队（仅供发送线程调用）
  *
- * @param fd 摄像头设备文件描述符
- * @param fmt 输出的格式信息结构体指针
- * @return 成功返回0，失败返回-1
+ * @param ring 环形队列指针
+ * @param frame 输出帧描述符
+ * @return 成功返回0，队列空返回-1
  */
-int set_format_mp(int fd, struct v4l2_format* fmt)
+int ring_pop(struct frame_ring* ring, struct frame_data* frame)
 {
-    memset(fmt, 0, sizeof(*fmt));
-    fmt->type                   = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    fmt->fmt.pix_mp.width       = WIDTH;
-    fmt->fmt.pix_mp.height      = HEIGHT;
-    fmt->fmt.pix_mp.pixelformat = PIXELFORMAT;
-    fmt->fmt.pix_mp.field       = V4L2_FIELD_NONE;
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
 
-    if (xioctl(fd, VIDIOC_S_FMT, fmt) == -1)
+    if (head == tail)
     {
-        perror("VIDIOC_S_FMT failed");
         return -1;
     }
 
-    printf("Format set: %dx%d, BG10, %d planes\n",
-           fmt->fmt.pix_mp.width,
-           fmt->fmt.pix_mp.height,
-           fmt->fmt.pix_mp.num_planes);
-
+    *frame = ring->slots[tail & (ring->depth - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    ring->consumed++;
     return 0;
 }
 
-// ========================== V4L2缓冲区管理函数 ==========================
+// ========================== 压缩管线 ==========================
 
-/**
- * @brief 申请并映射V4L2多平面缓冲区
- *
- * 向内核申请指定数量的视频缓冲区，并将它们映射到用户空间。
- * 使用内存映射(mmap)方式，避免数据拷贝，提高性能。
- *
- * @param fd 摄像头设备文件描述符
- * @param buffers 输出的缓冲区数组
- * @param count 请求的缓冲区数量
- * @return 成功返回实际分配的缓冲区数量，失败返回-1
- */
-int request_buffers_mp(int fd, struct buffer* buffers, int count)
-{
-    struct v4l2_requestbuffers reqbuf = {0};
-    reqbuf.count                      = count;
-    reqbuf.type                       = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    reqbuf.memory                     = V4L2_MEMORY_MMAP;
+/** @brief 是否启用压缩管线（-C标志） */
+int compress_requested = 0;
 
-    if (xioctl(fd, VIDIOC_REQBUFS, &reqbuf) == -1)
-    {
-        perror("VIDIOC_REQBUFS failed");
-        return -1;
-    }
+/** @brief 压缩线程与发送线程之间的帧环形队列 */
+struct frame_ring comp_queue = {0};
 
-    for (int i = 0; i < reqbuf.count; i++)
-    {
-        struct v4l2_buffer buf                     = {0};
-        struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+/** @brief 发送线程实际消费的队列（压缩启用时指向comp_queue） */
+struct frame_ring* sender_queue = &frame_queue;
 
-        buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-        buf.memory   = V4L2_MEMORY_MMAP;
-        buf.index    = i;
-        buf.m.planes = planes;
-        buf.length   = VIDEO_MAX_PLANES;
+/** @brief 采集线程的下游唤醒fd（压缩启用时指向压缩线程） */
+int capture_notify_fd = -1;
 
-        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1)
-        {
-            perror("VIDIOC_QUERYBUF failed");
-            return -1;
-        }
+/** @brief 压缩线程唤醒eventfd */
+int comp_wake_fd = -1;
 
-        buffers[i].num_planes = buf.length;
+/** @brief 压缩输出缓冲区池 */
+uint8_t* comp_pool[COMP_POOL_COUNT];
 
-        for (int p = 0; p < buf.length; p++)
-        {
-            buffers[i].length[p] = buf.m.planes[p].length;
-            buffers[i].start[p]  = mmap(NULL,
-                                       buf.m.planes[p].length,
-                                       PROT_READ | PROT_WRITE,
-                                       MAP_SHARED,
-                                       fd,
-                                       buf.m.planes[p].m.mem_offset);
+/** @brief 压缩输出缓冲区容量 */
+size_t comp_buf_size = 0;
 
-            if (MAP_FAILED == buffers[i].start[p])
-            {
-                perror("mmap failed");
-                return -1;
-            }
+/** @brief 压缩池空闲槽位位图（原子访问） */
+uint32_t comp_free_mask = (1u << COMP_POOL_COUNT) - 1;
+
+/** @brief 压缩统计：压缩帧数/旁路帧数/输入输出字节数 */
+uint64_t comp_frames = 0, comp_bypassed = 0;
+uint64_t comp_bytes_in = 0, comp_bytes_out = 0;
+
+/**
+ * @brief 从压缩池中分配一个空闲缓冲区槽位
+ *
+ * @return 槽位索引，池空返回-1
+ */
+int comp_slot_alloc(void)
+{
+    uint32_t mask = __atomic_load_n(&comp_free_mask, __ATOMIC_ACQUIRE);
+
+    while (mask != 0)
+    {
+        int slot = __builtin_ctz(mask);
+        if (__atomic_compare_exchange_n(&comp_free_mask,
+                                        &mask,
+                                        mask & ~(1u << slot),
+                                        0,
+                                        __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE))
+        {
+            return slot;
         }
     }
 
-    printf("Allocated %d buffers\n", reqbuf.count);
-    return reqbuf.count;
+    return -1;
 }
 
 /**
- * @brief 将缓冲区加入V4L2队列
- *
- * 将空闲的缓冲区提交给驱动程序，用于接收下一帧图像数据。
+ * @brief 归还压缩池缓冲区槽位
  *
- * @param fd 摄像头设备文件描述符
- * @param index 缓冲区索引
- * @return 成功返回0，失败返回-1
+ * @param slot 槽位索引
  */
-int queue_buffer_mp(int fd, int index)
+void comp_slot_free(int slot)
 {
-    struct v4l2_buffer buf                     = {0};
-    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
-
-    buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    buf.memory   = V4L2_MEMORY_MMAP;
-    buf.index    = index;
-    buf.m.planes = planes;
-    buf.length   = VIDEO_MAX_PLANES;
-
-    return xioctl(fd, VIDIOC_QBUF, &buf);
+    __atomic_fetch_or(&comp_free_mask, 1u << slot, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief 从V4L2队列中取出已填充的缓冲区
+ * @brief 释放帧占用的资源
  *
- * 从驱动程序队列中取出包含图像数据的缓冲区，获取缓冲区索引和数据大小。
+ * 压缩帧归还池槽位，原始帧归还V4L2缓冲区租借。
  *
- * @param fd 摄像头设备文件描述符
- * @param index 输出缓冲区索引
- * @param bytes_used 输出实际使用的字节数
- * @return 成功返回0，失败返回-1
+ * @param frame 帧描述符
  */
-int dequeue_buffer_mp(int fd, int* index, size_t* bytes_used)
+void frame_resource_release(const struct frame_data* frame)
 {
-    struct v4l2_buffer buf                     = {0};
-    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
-
-    buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    buf.memory   = V4L2_MEMORY_MMAP;
-    buf.m.planes = planes;
-    buf.length   = VIDEO_MAX_PLANES;
-
-    if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1)
+    if (frame->compressed)
     {
-        return -1;
+        comp_slot_free(frame->buf_index);
+    }
+    else
+    {
+        lease_release(frame->buf_index);
     }
-
-    *index      = buf.index;
-    *bytes_used = buf.m.planes[0].bytesused;
-    return 0;
 }
 
-// ========================== V4L2流控制函数 ==========================
+// ========================== 延迟统计 ==========================
 
 /**
- * @brief 启动V4L2视频流
- *
- * 通知驱动程序开始图像采集，此后可以从队列中获取图像数据。
+ * @struct latency_hist
+ * @brief 固定分桶延迟直方图
  *
- * @param fd 摄像头设备文件描述符
- * @return 成功返回0，失败返回-1
+ * 按微秒值的log2分桶，记录开销仅为一次clz与两次加法，
+ * 适合放在热路径上常开。每个直方图只由单一线程写入，
+ * 统计服务线程的并发读取允许轻微不一致。
  */
-int start_streaming_mp(int fd)
+struct latency_hist
 {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    uint64_t count;                 /**< 样本总数 */
+    uint64_t sum_us;                /**< 样本总和，微秒 */
+    uint64_t max_us;                /**< 最大样本，微秒 */
+    uint64_t buckets[HIST_BUCKETS]; /**< log2分桶计数 */
+};
 
-    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1)
-    {
-        perror("VIDIOC_STREAMON failed");
+/** @brief 传感器就绪到DQBUF的延迟（采集线程写入） */
+struct latency_hist hist_capture = {0};
+
+/** @brief DQBUF到发送线程取走的排队延迟（发送线程写入） */
+struct latency_hist hist_queue = {0};
+
+/** @brief 单客户端帧发送耗时（发送线程写入） */
+struct latency_hist hist_send = {0};
+
+/**
+ * @brief 记录一个延迟样本
+ *
+ * @param h 直方图指针
+ * @param ns 延迟值，纳秒
+ */
+static inline void hist_record(struct latency_hist* h, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int idx     = 63 - __builtin_clzll(us | 1);
+    if (idx >= HIST_BUCKETS)
+    {
+        idx = HIST_BUCKETS - 1;
+    }
+
+    h->buckets[idx]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us)
+    {
+        h->max_us = us;
+    }
+}
+
+/**
+ * @brief 从直方图估算百分位数
+ *
+ * 返回包含该百分位样本的桶的上界（微秒），
+ * log2分桶下误差不超过2倍，足以观察量级与趋势。
+ *
+ * @param h 直方图指针
+ * @param pct 百分位（如50、95、99）
+ * @return 百分位延迟估计值，微秒
+ */
+uint64_t hist_percentile(const struct latency_hist* h, int pct)
+{
+    if (h->count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = (h->count * pct + 99) / 100;
+    uint64_t seen   = 0;
+
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen >= target)
+        {
+            return 2ull << i;
+        }
+    }
+
+    return h->max_us;
+}
+
+// ========================== DMABUF导出 ==========================
+
+int xioctl(int fd, int request, void* arg);  // 前向声明，导出时使用
+
+/** @brief DMABUF导出unix socket路径（-E标志），NULL表示禁用 */
+const char* dmabuf_sock_path = NULL;
+
+/** @brief 每个V4L2缓冲区导出的dmabuf文件描述符 */
+int dmabuf_fds[MAX_BUFFER_COUNT];
+
+/** @brief 导出的缓冲区数量 */
+int dmabuf_count = 0;
+
+/** @brief DMABUF导出unix socket监听描述符 */
+int dmabuf_listen_fd = -1;
+
+/**
+ * @struct dmabuf_export_info
+ * @brief DMABUF导出信息，随SCM_RIGHTS附带的fd一起发送
+ */
+struct dmabuf_export_info
+{
+    uint32_t magic;                      /**< 魔数：0xDABFDABF */
+    uint32_t count;                      /**< 导出的缓冲区数量 */
+    uint32_t width;                      /**< 图像宽度 */
+    uint32_t height;                     /**< 图像高度 */
+    uint32_t pixfmt;                     /**< 像素格式 */
+    uint32_t length[MAX_BUFFER_COUNT];   /**< 每个缓冲区的大小 */
+} __attribute__((packed));
+
+/** @brief 各缓冲区大小，填充导出信息用 */
+static uint32_t dmabuf_lengths[MAX_BUFFER_COUNT];
+
+/**
+ * @brief 将V4L2缓冲区导出为dmabuf文件描述符
+ *
+ * 通过VIDIOC_EXPBUF把MMAP方式申请的缓冲区第0平面导出为
+ * dmabuf fd，同机的其他进程收到fd后可直接mmap，实现零拷贝
+ * 帧共享（无需经过回环TCP）。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @param buffers 缓冲区数组
+ * @param count 缓冲区数量
+ * @return 成功返回0，失败返回-1
+ */
+int export_dmabuf_fds(int fd, struct buffer* buffers, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        struct v4l2_exportbuffer exp = {0};
+        exp.type  = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        exp.index = i;
+        exp.plane = 0;
+        exp.flags = O_RDONLY | O_CLOEXEC;
+
+        if (xioctl(fd, VIDIOC_EXPBUF, &exp) == -1)
+        {
+            perror("VIDIOC_EXPBUF failed");
+            return -1;
+        }
+
+        dmabuf_fds[i]     = exp.fd;
+        dmabuf_lengths[i] = buffers[i].length[0];
+    }
+
+    dmabuf_count = count;
+    printf("Exported %d dmabuf fds\n", count);
+    return 0;
+}
+
+/**
+ * @brief DMABUF导出服务线程函数
+ *
+ * 在unix域socket上监听，连接到来时发送导出信息结构体，
+ * 并通过SCM_RIGHTS控制消息把全部dmabuf fd传递给对端进程。
+ * 对端收到后即可mmap各缓冲区，与本进程零拷贝共享帧数据。
+ *
+ * @param arg 线程参数（当前未使用）
+ * @return 线程退出时返回NULL
+ */
+void* dmabuf_exporter_thread(void* arg)
+{
+    printf("DMABUF exporter listening on %s\n", dmabuf_sock_path);
+
+    while (running)
+    {
+        struct pollfd pfd = {.fd = dmabuf_listen_fd, .events = POLLIN};
+        if (poll(&pfd, 1, 500) <= 0)
+        {
+            continue;
+        }
+
+        int peer = accept(dmabuf_listen_fd, NULL, NULL);
+        if (peer < 0)
+        {
+            continue;
+        }
+
+        struct dmabuf_export_info info = {.magic  = DMABUF_MAGIC,
+                                          .count  = dmabuf_count,
+                                          .width  = WIDTH,
+                                          .height = HEIGHT,
+                                          .pixfmt = PIXELFORMAT};
+        memcpy(info.length, dmabuf_lengths, sizeof(info.length));
+
+        struct iovec iov = {.iov_base = &info, .iov_len = sizeof(info)};
+        char cmsg_buf[CMSG_SPACE(sizeof(int) * MAX_BUFFER_COUNT)];
+        memset(cmsg_buf, 0, sizeof(cmsg_buf));
+
+        struct msghdr msg  = {0};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = cmsg_buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * dmabuf_count);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level     = SOL_SOCKET;
+        cmsg->cmsg_type      = SCM_RIGHTS;
+        cmsg->cmsg_len       = CMSG_LEN(sizeof(int) * dmabuf_count);
+        memcpy(CMSG_DATA(cmsg), dmabuf_fds, sizeof(int) * dmabuf_count);
+
+        if (sendmsg(peer, &msg, MSG_NOSIGNAL) < 0)
+        {
+            perror("dmabuf sendmsg failed");
+        }
+        else
+        {
+            printf("Shared %d dmabuf fds with local consumer\n", dmabuf_count);
+        }
+
+        close(peer);
+    }
+
+    printf("DMABUF exporter terminated\n");
+    return NULL;
+}
+
+/**
+ * @brief 创建DMABUF导出unix域socket
+ *
+ * @param path socket文件路径（已存在时会被删除重建）
+ * @return 成功返回0，失败返回-1
+ */
+int create_dmabuf_socket(const char* path)
+{
+    dmabuf_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (dmabuf_listen_fd < 0)
+    {
+        perror("unix socket failed");
+        return -1;
+    }
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family         = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+
+    if (bind(dmabuf_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        perror("unix bind failed");
+        close(dmabuf_listen_fd);
+        dmabuf_listen_fd = -1;
+        return -1;
+    }
+
+    if (listen(dmabuf_listen_fd, 2) < 0)
+    {
+        perror("unix listen failed");
+        close(dmabuf_listen_fd);
+        dmabuf_listen_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 获取高精度时间戳
+ *
+ * 使用CLOCK_MONOTONIC时钟获取纳秒级别的时间戳，
+ * 该时钟不受系统时间调整影响，适合性能测量。
+ *
+ * @return 返回纳秒级时间戳
+ */
+static inline uint64_t get_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 系统信号处理函数
+ *
+ * 处理SIGINT、SIGTERM等信号，实现程序的优雅退出。
+ * 会强制关闭所有阻塞的系统调用，并通知所有等待的线程。
+ *
+ * @param sig 接收到的信号编号
+ */
+void signal_handler(int sig)
+{
+    printf("\nReceived signal %d, shutting down...\n", sig);
+    running = 0;
+
+    // 强制关闭服务器socket，打断epoll中的accept事件
+    if (server_fd >= 0)
+    {
+        shutdown(server_fd, SHUT_RDWR);
+    }
+
+    // 写入帧事件fd，唤醒发送线程的epoll_wait
+    if (frame_event_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t n    = write(frame_event_fd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+/**
+ * @brief V4L2 ioctl系统调用包装函数
+ *
+ * 提供带重试机制的ioctl调用，自动处理EINTR信号中断。
+ * 这是V4L2编程的标准做法，确保系统调用的可靠性。
+ *
+ * @param fd 文件描述符
+ * @param request ioctl请求代码
+ * @param arg 请求参数指针
+ * @return 成功返回0，失败返回-1
+ */
+int xioctl(int fd, int request, void* arg)
+{
+    int r;
+    do
+    {
+        r = ioctl(fd, request, arg);
+    } while (-1 == r && EINTR == errno);
+    return r;
+}
+
+// ========================== 调度设置 ==========================
+
+/**
+ * @brief 将当前线程切换到SCHED_FIFO实时调度
+ *
+ * 单核RV1103上采集与发送线程会和rkipc等系统进程竞争CPU，
+ * CFS调度下系统繁忙时DQBUF延迟会出现数十毫秒的尖刺。
+ * 实时优先级让采集路径优先抢占。需要root权限，
+ * 失败（如EPERM）时仅告警并继续以普通优先级运行。
+ *
+ * @param name 线程名称，用于日志输出
+ * @param prio SCHED_FIFO优先级（1-99）
+ * @return 成功返回0，失败返回-1
+ */
+int setup_realtime_sched(const char* name, int prio)
+{
+    if (!rt_enabled)
+    {
+        return 0;
+    }
+
+    if (prio < 1)
+    {
+        prio = 1;
+    }
+    else if (prio > 99)
+    {
+        prio = 99;
+    }
+
+    struct sched_param param = {.sched_priority = prio};
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0)
+    {
+        printf("Warning: SCHED_FIFO prio %d for %s failed (%s), "
+               "continuing with default scheduling\n",
+               prio,
+               name,
+               strerror(err));
+        return -1;
+    }
+
+    printf("%s: SCHED_FIFO priority %d\n", name, prio);
+    return 0;
+}
+
+/**
+ * @brief 锁定采集缓冲区的物理内存
+ *
+ * mmap的缓冲区在内存压力下可能被换出，DQBUF后首次访问
+ * 触发缺页会拖慢热路径。将所有平面映射锁定在物理内存中，
+ * 失败（如RLIMIT_MEMLOCK不足）时仅告警。
+ *
+ * @param buffers 缓冲区数组
+ * @param count 缓冲区数量
+ */
+void lock_buffer_memory(struct buffer* buffers, int count)
+{
+    if (!rt_enabled)
+    {
+        return;
+    }
+
+    size_t locked = 0;
+    for (int i = 0; i < count; i++)
+    {
+        for (int p = 0; p < buffers[i].num_planes; p++)
+        {
+            if (mlock(buffers[i].start[p], buffers[i].length[p]) != 0)
+            {
+                printf("Warning: mlock buffer %d plane %d failed (%s)\n",
+                       i,
+                       p,
+                       strerror(errno));
+            }
+            else
+            {
+                locked += buffers[i].length[p];
+            }
+        }
+    }
+
+    if (locked > 0)
+    {
+        printf("Locked %zu KB of capture buffers in memory\n", locked / 1024);
+    }
+}
+
+// ========================== V4L2设备管理函数 ==========================
+
+/**
+ * @brief 检查V4L2设备能力
+ *
+ * 查询摄像头设备的基本信息和支持的功能，确保设备支持：
+ * - 多平面视频采集 (V4L2_CAP_VIDEO_CAPTURE_MPLANE)
+ * - 流式传输 (V4L2_CAP_STREAMING)
+ *
+ * @param fd 摄像头设备文件描述符
+ * @return 成功返回0，失败返回-1
+ */
+int check_device_caps(int fd)
+{
+    struct v4l2_capability cap = {0};
+
+    if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == -1)
+    {
+        perror("VIDIOC_QUERYCAP failed");
+        return -1;
+    }
+
+    printf("Device: %s\n", cap.card);
+    printf("Driver: %s\n", cap.driver);
+
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE))
+    {
+        printf("Device does not support multiplanar video capture\n");
+        return -1;
+    }
+
+    if (!(cap.capabilities & V4L2_CAP_STREAMING))
+    {
+        printf("Device does not support streaming\n");
+        return -1;
+    }
+
+    printf("Device supports multiplanar streaming capture\n");
+    return 0;
+}
+
+/**
+ * @brief 设置V4L2多平面视频格式
+ *
+ * 配置摄像头的输出格式，包括分辨率、像素格式等参数。
+ * 使用多平面格式以支持更灵活的内存管理。分辨率取自可经
+ * 协商修改的g_width/g_height；请求了ROI时在S_FMT之后通过
+ * VIDIOC_S_SELECTION应用裁剪区域，驱动调整后的实际值会
+ * 写回全局变量供帧头使用。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @param fmt 输出的格式信息结构体指针
+ * @return 成功返回0，失败返回-1
+ */
+int set_format_mp(int fd, struct v4l2_format* fmt)
+{
+    memset(fmt, 0, sizeof(*fmt));
+    fmt->type                   = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    fmt->fmt.pix_mp.width       = g_width;
+    fmt->fmt.pix_mp.height      = g_height;
+    fmt->fmt.pix_mp.pixelformat = PIXELFORMAT;
+    fmt->fmt.pix_mp.field       = V4L2_FIELD_NONE;
+
+    if (xioctl(fd, VIDIOC_S_FMT, fmt) == -1)
+    {
+        perror("VIDIOC_S_FMT failed");
+        return -1;
+    }
+
+    // 应用协商得到的ROI裁剪区域，不支持裁剪的驱动告警后
+    // 回退到全幅输出
+    if (roi_requested)
+    {
+        struct v4l2_selection sel = {0};
+        sel.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        sel.target = V4L2_SEL_TGT_CROP;
+        sel.r      = roi_rect;
+
+        if (xioctl(fd, VIDIOC_S_SELECTION, &sel) == -1)
+        {
+            perror("VIDIOC_S_SELECTION failed, using full frame");
+            roi_requested = 0;
+        }
+        else
+        {
+            // 驱动可能对齐调整过裁剪区域，以实际值为准
+            roi_rect = sel.r;
+            printf("ROI applied: %dx%d @ (%d,%d)\n",
+                   sel.r.width,
+                   sel.r.height,
+                   sel.r.left,
+                   sel.r.top);
+
+            // 裁剪改变输出尺寸时重新读取格式
+            if (xioctl(fd, VIDIOC_G_FMT, fmt) == -1)
+            {
+                perror("VIDIOC_G_FMT failed");
+                return -1;
+            }
+        }
+    }
+
+    g_width  = fmt->fmt.pix_mp.width;
+    g_height = fmt->fmt.pix_mp.height;
+
+    printf("Format set: %dx%d, BG10, %d planes\n",
+           fmt->fmt.pix_mp.width,
+           fmt->fmt.pix_mp.height,
+           fmt->fmt.pix_mp.num_planes);
+
+    return 0;
+}
+
+// ========================== V4L2缓冲区管理函数 ==========================
+
+/**
+ * @brief 申请并映射V4L2多平面缓冲区
+ *
+ * 向内核申请指定数量的视频缓冲区，并将它们映射到用户空间。
+ * 使用内存映射(mmap)方式，避免数据拷贝，提高性能。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @param buffers 输出的缓冲区数组
+ * @param count 请求的缓冲区数量
+ * @return 成功返回实际分配的缓冲区数量，失败返回-1
+ */
+int request_buffers_mp(int fd, struct buffer* buffers, int count)
+{
+    struct v4l2_requestbuffers reqbuf = {0};
+    reqbuf.count                      = count;
+    reqbuf.type                       = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    reqbuf.memory                     = V4L2_MEMORY_MMAP;
+
+    if (xioctl(fd, VIDIOC_REQBUFS, &reqbuf) == -1)
+    {
+        perror("VIDIOC_REQBUFS failed");
+        return -1;
+    }
+
+    for (int i = 0; i < reqbuf.count; i++)
+    {
+        struct v4l2_buffer buf                     = {0};
+        struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+        buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        buf.memory   = V4L2_MEMORY_MMAP;
+        buf.index    = i;
+        buf.m.planes = planes;
+        buf.length   = VIDEO_MAX_PLANES;
+
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1)
+        {
+            perror("VIDIOC_QUERYBUF failed");
+            return -1;
+        }
+
+        buffers[i].num_planes = buf.length;
+
+        for (int p = 0; p < buf.length; p++)
+        {
+            buffers[i].length[p] = buf.m.planes[p].length;
+            buffers[i].start[p]  = mmap(NULL,
+                                       buf.m.planes[p].length,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED,
+                                       fd,
+                                       buf.m.planes[p].m.mem_offset);
+
+            if (MAP_FAILED == buffers[i].start[p])
+            {
+                perror("mmap failed");
+                return -1;
+            }
+        }
+    }
+
+    printf("Allocated %d buffers\n", reqbuf.count);
+    return reqbuf.count;
+}
+
+/**
+ * @brief 将缓冲区加入V4L2队列
+ *
+ * 将空闲的缓冲区提交给驱动程序，用于接收下一帧图像数据。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @param index 缓冲区索引
+ * @return 成功返回0，失败返回-1
+ */
+int queue_buffer_mp(int fd, int index)
+{
+    struct v4l2_buffer buf                     = {0};
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+    buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buf.memory   = V4L2_MEMORY_MMAP;
+    buf.index    = index;
+    buf.m.planes = planes;
+    buf.length   = VIDEO_MAX_PLANES;
+
+    return xioctl(fd, VIDIOC_QBUF, &buf);
+}
+
+/**
+ * @brief 从V4L2队列中取出已填充的缓冲区
+ *
+ * 从驱动程序队列中取出包含图像数据的缓冲区，获取缓冲区索引和数据大小。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @param index 输出缓冲区索引
+ * @param bytes_used 输出实际使用的字节数
+ * @param hw_timestamp 输出驱动填充时间戳（纳秒），用于延迟统计
+ * @return 成功返回0，失败返回-1
+ */
+int dequeue_buffer_mp(int fd, int* index, size_t* bytes_used,
+                      uint64_t* hw_timestamp)
+{
+    struct v4l2_buffer buf                     = {0};
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+    buf.type     = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buf.memory   = V4L2_MEMORY_MMAP;
+    buf.m.planes = planes;
+    buf.length   = VIDEO_MAX_PLANES;
+
+    if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1)
+    {
+        return -1;
+    }
+
+    *index      = buf.index;
+    *bytes_used = buf.m.planes[0].bytesused;
+    *hw_timestamp = (uint64_t)buf.timestamp.tv_sec * 1000000000ULL +
+                    (uint64_t)buf.timestamp.tv_usec * 1000ULL;
+    return 0;
+}
+
+// ========================== V4L2流控制函数 ==========================
+
+/**
+ * @brief 启动V4L2视频流
+ *
+ * 通知驱动程序开始图像采集，此后可以从队列中获取图像数据。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @return 成功返回0，失败返回-1
+ */
+int start_streaming_mp(int fd)
+{
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1)
+    {
+        perror("VIDIOC_STREAMON failed");
+        return -1;
+    }
+
+    printf("Streaming started\n");
+    return 0;
+}
+
+/**
+ * @brief 停止V4L2视频流
+ *
+ * 通知驱动程序停止图像采集，清空所有队列中的缓冲区。
+ *
+ * @param fd 摄像头设备文件描述符
+ * @return 成功返回0，失败返回-1
+ */
+int stop_streaming_mp(int fd)
+{
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+
+    if (xioctl(fd, VIDIOC_STREAMOFF, &type) == -1)
+    {
+        perror("VIDIOC_STREAMOFF failed");
+        return -1;
+    }
+
+    printf("Streaming stopped\n");
+    return 0;
+}
+
+// ========================== 网络通信函数 ==========================
+
+/**
+ * @brief 创建TCP服务器
+ *
+ * 创建并配置TCP服务器socket，绑定到指定的IP地址和端口，
+ * 开始监听客户端连接请求。
+ *
+ * @param port 服务器监听端口
+ * @return 成功返回服务器socket文件描述符，失败返回-1
+ */
+int create_server(int port)
+{
+    int fd;
+    struct sockaddr_in addr;
+    int opt = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket failed");
+        return -1;
+    }
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("setsockopt failed");
+        close(fd);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(DEFAULT_SERVER_IP);
+    addr.sin_port        = htons(port);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind failed");
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, MAX_CLIENTS) < 0)
+    {
+        perror("listen failed");
+        close(fd);
+        return -1;
+    }
+
+    // 非阻塞accept，配合epoll事件循环使用
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl >= 0)
+    {
+        fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+    }
+
+    printf("Server listening on %s:%d (max %d clients)\n",
+           DEFAULT_SERVER_IP,
+           port,
+           MAX_CLIENTS);
+    return fd;
+}
+
+/**
+ * @struct frame_header
+ * @brief 数据帧头部结构
+ *
+ * 定义传输协议的帧头格式，包含帧的元数据信息。
+ * 使用packed属性确保结构体内存布局的一致性。
+ */
+struct frame_header
+{
+    uint32_t magic;       /**< 魔数标识：0xDEADBEEF */
+    uint32_t frame_id;    /**< 帧序号 */
+    uint32_t width;       /**< 图像宽度 */
+    uint32_t height;      /**< 图像高度 */
+    uint32_t pixfmt;      /**< 像素格式 */
+    uint32_t size;        /**< 数据大小 */
+    uint64_t timestamp;   /**< 时间戳 */
+    uint32_t reserved[2]; /**< 保留字段 */
+} __attribute__((packed));
+
+/**
+ * @struct client_ctrl
+ * @brief 客户端控制消息
+ *
+ * 客户端连接后可以发送一条控制消息协商流模式，
+ * 例如请求8位压扩预览流以减半链路带宽。
+ * 设备通过帧头的pixfmt字段告知客户端实际的像素格式。
+ */
+struct client_ctrl
+{
+    uint32_t magic; /**< 控制消息魔数：0xC0DEC0DE */
+    uint32_t mode;  /**< 请求的流模式，STREAM_MODE_* */
+} __attribute__((packed));
+
+/**
+ * @struct stripe_ctrl
+ * @brief 条带流加入消息
+ *
+ * 多连接条带化传输：客户端开N条连接，每条发送本消息声明
+ * 自己是第index/count路流。设备按frame_id轮转把帧分配到
+ * 各路流上，绕开单TCP流的吞吐上限；未发送本消息的连接
+ * 仍然接收全部帧（默认单流路径不变）。
+ */
+struct stripe_ctrl
+{
+    uint32_t magic; /**< 条带消息魔数：0xC0DE5721 */
+    uint32_t index; /**< 本连接的流序号，0..count-1 */
+    uint32_t count; /**< 条带流总数 */
+} __attribute__((packed));
+
+/**
+ * @struct credit_ctrl
+ * @brief 信用流控授予消息
+ *
+ * 客户端发送本消息启用应用层流控并授予N帧发送信用，
+ * 之后每消费一帧补发。设备每向该客户端排队一帧消耗一个
+ * 信用，耗尽时直接丢帧而非依赖TCP背压，这样客户端卡顿
+ * 只表现为有界的、按策略计数的丢帧，不会反压到采集循环。
+ */
+struct credit_ctrl
+{
+    uint32_t magic;   /**< 信用消息魔数：0xC0DEC4ED */
+    uint32_t credits; /**< 本次授予的帧信用数 */
+} __attribute__((packed));
+
+/**
+ * @struct fmt_request
+ * @brief 格式/ROI协商消息
+ *
+ * -n模式下，流启动前的第一个连接可以发送该消息请求输出
+ * 分辨率或ROI裁剪区域。设备应用后用同一结构回传实际生效
+ * 的参数（驱动可能做过对齐调整），然后关闭协商连接，
+ * 客户端再按正常流程连接数据端口。
+ */
+struct fmt_request
+{
+    uint32_t magic;       /**< 协商消息魔数：0xF047F047 */
+    uint32_t width;       /**< 请求的输出宽度，0表示默认 */
+    uint32_t height;      /**< 请求的输出高度，0表示默认 */
+    uint32_t crop_left;   /**< ROI左上角X坐标 */
+    uint32_t crop_top;    /**< ROI左上角Y坐标 */
+    uint32_t crop_width;  /**< ROI宽度，0表示不裁剪 */
+    uint32_t crop_height; /**< ROI高度 */
+} __attribute__((packed));
+
+/**
+ * @brief 等待并解析格式协商连接
+ *
+ * 在流启动前阻塞等待第一个TCP连接并读取fmt_request消息，
+ * 将请求的分辨率与ROI写入全局变量供set_format_mp()使用。
+ * 超时、消息无效或魔数不符时按默认格式继续，不影响启动。
+ *
+ * @param timeout_ms 等待连接的超时时间（毫秒）
+ * @return 成功返回协商连接fd（待回传实际格式），失败返回-1
+ */
+int wait_format_request(int timeout_ms)
+{
+    printf("Waiting %d ms for format negotiation connection...\n", timeout_ms);
+
+    struct pollfd pfd = {.fd = server_fd, .events = POLLIN};
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+    {
+        printf("No negotiation connection, using default format\n");
+        return -1;
+    }
+
+    int fd = accept(server_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    // 限时读取协商消息，防止异常客户端卡住启动
+    struct timeval tv = {.tv_sec = 2, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct fmt_request req;
+    ssize_t r = recv(fd, &req, sizeof(req), MSG_WAITALL);
+    if (r != (ssize_t)sizeof(req) || req.magic != FMT_MAGIC)
+    {
+        printf("Invalid negotiation message, using default format\n");
+        close(fd);
         return -1;
     }
 
-    printf("Streaming started\n");
-    return 0;
+    if (req.width > 0 && req.height > 0)
+    {
+        g_width  = req.width;
+        g_height = req.height;
+    }
+
+    if (req.crop_width > 0 && req.crop_height > 0)
+    {
+        roi_rect.left   = req.crop_left;
+        roi_rect.top    = req.crop_top;
+        roi_rect.width  = req.crop_width;
+        roi_rect.height = req.crop_height;
+        roi_requested   = 1;
+
+        // 裁剪后输出尺寸即ROI尺寸
+        g_width  = req.crop_width;
+        g_height = req.crop_height;
+    }
+
+    printf("Negotiated format request: %ux%u%s\n",
+           g_width,
+           g_height,
+           roi_requested ? " (ROI)" : "");
+    return fd;
+}
+
+/**
+ * @brief 回传实际生效的格式并关闭协商连接
+ *
+ * @param fd 协商连接文件描述符
+ */
+void send_format_reply(int fd)
+{
+    struct fmt_request reply = {.magic       = FMT_MAGIC,
+                                .width       = g_width,
+                                .height      = g_height,
+                                .crop_left   = roi_requested ? roi_rect.left : 0,
+                                .crop_top    = roi_requested ? roi_rect.top : 0,
+                                .crop_width  = roi_requested ? roi_rect.width : 0,
+                                .crop_height =
+                                    roi_requested ? roi_rect.height : 0};
+
+    ssize_t n = send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+    (void)n;
+    close(fd);
+}
+
+// ========================== 负载CRC32C校验 ==========================
+
+/** @brief 是否在帧头携带负载CRC32C（--crc标志） */
+int crc_requested = 0;
+
+/** @brief slice-by-8软件实现的查找表，crc32c_init()生成 */
+static uint32_t crc32c_table[8][256];
+
+/**
+ * @brief 生成slice-by-8查找表
+ *
+ * 表共8KB，只在启用--crc时于启动期生成一次，
+ * 避免在源码里嵌入巨型常量数组。
+ */
+void crc32c_init(void)
+{
+    // CRC32C（Castagnoli）反射多项式
+    const uint32_t poly = 0x82F63B78u;
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        }
+        crc32c_table[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        for (int t = 1; t < 8; t++)
+        {
+            crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^
+                                 crc32c_table[0][crc32c_table[t - 1][i] & 0xFF];
+        }
+    }
+}
+
+/**
+ * @brief 计算负载的CRC32C校验和
+ *
+ * 带CRC扩展的ARMv8核用硬件指令；本机Cortex-A7走slice-by-8
+ * 软件路径，每次迭代消费8字节，整帧约为链路发送耗时的几个
+ * 百分点，可常开。
+ *
+ * @param data 负载数据
+ * @param size 负载大小
+ * @return CRC32C校验和
+ */
+uint32_t crc32c_compute(const uint8_t* data, size_t size)
+{
+#ifdef __ARM_FEATURE_CRC32
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i     = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for (; i < size; i++)
+    {
+        crc = __crc32cb(crc, data[i]);
+    }
+    return crc ^ 0xFFFFFFFFu;
+#else
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i     = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint32_t lo = crc ^ ((uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+                             ((uint32_t)data[i + 2] << 16) |
+                             ((uint32_t)data[i + 3] << 24));
+        uint32_t hi = (uint32_t)data[i + 4] | ((uint32_t)data[i + 5] << 8) |
+                      ((uint32_t)data[i + 6] << 16) |
+                      ((uint32_t)data[i + 7] << 24);
+
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^
+              crc32c_table[4][(lo >> 24) & 0xFF] ^
+              crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^
+              crc32c_table[0][(hi >> 24) & 0xFF];
+    }
+    for (; i < size; i++)
+    {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ data[i]) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFFu;
+#endif
+}
+
+// ========================== 预览压扩处理 ==========================
+
+/**
+ * @brief SBGGR10压扩为8位（标量版本）
+ *
+ * 每5字节输入包含4个10位像素，取每个像素的高8位输出。
+ *
+ * @param src 输入的SBGGR10打包数据
+ * @param dst 输出的8位像素数据
+ * @param num_groups 5字节组数量
+ */
+void compand_sbggr10_to8_scalar(const uint8_t* src,
+                                uint8_t* dst,
+                                size_t num_groups)
+{
+    for (size_t g = 0; g < num_groups; g++)
+    {
+        const uint8_t* b = src + g * 5;
+        uint8_t* p       = dst + g * 4;
+
+        // 4个10位像素依次占据40位中的bits[0..9]、[10..19]、
+        // [20..29]、[30..39]，高8位即压扩结果
+        p[0] = (uint8_t)((b[0] >> 2) | (b[1] << 6));
+        p[1] = (uint8_t)((b[1] >> 4) | (b[2] << 4));
+        p[2] = (uint8_t)((b[2] >> 6) | (b[3] << 2));
+        p[3] = b[4];
+    }
+}
+
+#ifdef __ARM_NEON
+/**
+ * @brief SBGGR10压扩为8位（NEON版本）
+ *
+ * 每次迭代处理8个5字节组（40字节输入，32像素输出）：
+ * 用vtbl4+vtbl1查表将5字节步长的b0..b4各自收集为8通道向量
+ * （两张表分别覆盖字节[0..31]和[32..39]，越界索引查表结果为0，
+ * vorr合并），再通过移位或运算得到4个像素平面，
+ * 最后vst4交织写出。
+ *
+ * @param src 输入的SBGGR10打包数据
+ * @param dst 输出的8位像素数据
+ * @param num_groups 5字节组数量
+ */
+void compand_sbggr10_to8_neon(const uint8_t* src,
+                              uint8_t* dst,
+                              size_t num_groups)
+{
+    static const uint8_t idx_base[8] = {0, 5, 10, 15, 20, 25, 30, 35};
+
+    size_t g = 0;
+
+    for (; g + 8 <= num_groups; g += 8)
+    {
+        const uint8_t* in = src + g * 5;
+
+        // 查找表覆盖40字节输入：tab0为字节[0..31]，tab1为[32..39]
+        uint8x8x4_t tab0 = {{vld1_u8(in),
+                             vld1_u8(in + 8),
+                             vld1_u8(in + 16),
+                             vld1_u8(in + 24)}};
+        uint8x8_t tab1   = vld1_u8(in + 32);
+
+        uint8x8_t base = vld1_u8(idx_base);
+        uint8x8_t b[5];
+
+        for (int k = 0; k < 5; k++)
+        {
+            uint8x8_t idx0 = vadd_u8(base, vdup_n_u8(k));
+            // tab1以字节32为起点，idx0<32时idx1下溢越界、查表得0，
+            // 因此两半结果互斥，可直接vorr合并
+            uint8x8_t idx1 = vsub_u8(idx0, vdup_n_u8(32));
+            b[k] = vorr_u8(vtbl4_u8(tab0, idx0), vtbl1_u8(tab1, idx1));
+        }
+
+        uint8x8x4_t out;
+        out.val[0] = vorr_u8(vshr_n_u8(b[0], 2), vshl_n_u8(b[1], 6));
+        out.val[1] = vorr_u8(vshr_n_u8(b[1], 4), vshl_n_u8(b[2], 4));
+        out.val[2] = vorr_u8(vshr_n_u8(b[2], 6), vshl_n_u8(b[3], 2));
+        out.val[3] = b[4];
+
+        vst4_u8(dst + g * 4, out);
+    }
+
+    // 尾部不足8组的部分用标量处理
+    if (g < num_groups)
+    {
+        compand_sbggr10_to8_scalar(src + g * 5, dst + g * 4, num_groups - g);
+    }
+}
+#endif
+
+/**
+ * @brief SBGGR10压扩为8位（自动选择最优实现）
+ *
+ * @param src 输入的SBGGR10打包数据
+ * @param dst 输出的8位像素数据
+ * @param raw_size 输入数据大小（必须是5的倍数）
+ * @return 输出数据大小
+ */
+size_t compand_sbggr10_to8(const uint8_t* src, uint8_t* dst, size_t raw_size)
+{
+    size_t num_groups = raw_size / 5;
+
+#ifdef __ARM_NEON
+    compand_sbggr10_to8_neon(src, dst, num_groups);
+#else
+    compand_sbggr10_to8_scalar(src, dst, num_groups);
+#endif
+
+    return num_groups * 4;
+}
+
+#ifdef MSG_ZEROCOPY
+/**
+ * @brief 回收MSG_ZEROCOPY发送完成通知
+ *
+ * 零拷贝发送后内核通过error queue上报完成事件，必须及时读取，
+ * 否则页面引用堆积会导致后续发送返回ENOBUFS。
+ * wait_ms>0时最多等待该时长，用于帧发送完毕后确认内核不再
+ * 引用mmap缓冲区，之后才能安全归还租借。
+ *
+ * @param fd 客户端socket文件描述符
+ * @param wait_ms 最大等待时间，0表示仅非阻塞回收
+ */
+void reap_zerocopy_completions(int fd, int wait_ms)
+{
+    uint64_t deadline = get_time_ns() + (uint64_t)wait_ms * 1000000ULL;
+
+    do
+    {
+        char ctrl[128];
+        struct msghdr msg = {0};
+        msg.msg_control   = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0)
+        {
+            return;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            return;
+        }
+
+        if (wait_ms > 0)
+        {
+            usleep(500);
+        }
+    } while (wait_ms > 0 && get_time_ns() < deadline);
+}
+#endif
+
+/**
+ * @brief 压缩管线线程函数
+ *
+ * 从采集环形队列取帧，LZ压缩到池缓冲区后交给发送线程：
+ * 压缩成功则立即归还V4L2缓冲区租借（发送不再依赖mmap内存），
+ * 收益不足（压缩比低于8/7）或池耗尽时原样透传。
+ * 连续收益不足会触发旁路窗口，后续COMP_BYPASS_FRAMES帧
+ * 直接透传，避免对不可压缩场景白白增加一帧延迟。
+ *
+ * @param arg 线程参数（当前未使用）
+ * @return 线程退出时返回NULL
+ */
+void* compressor_thread(void* arg)
+{
+    printf("Compressor thread started (gate ratio %d/%d)\n",
+           COMP_GATE_NUM,
+           COMP_GATE_DEN);
+
+    uint32_t bypass_left = 0;
+
+    while (running)
+    {
+        struct frame_data frame;
+
+        if (ring_pop(&frame_queue, &frame) < 0)
+        {
+            struct pollfd pfd = {.fd = comp_wake_fd, .events = POLLIN};
+            if (poll(&pfd, 1, 100) > 0)
+            {
+                uint64_t cnt;
+                ssize_t n = read(comp_wake_fd, &cnt, sizeof(cnt));
+                (void)n;
+            }
+            continue;
+        }
+
+        struct frame_data out = frame;
+
+        if (bypass_left > 0)
+        {
+            bypass_left--;
+            comp_bypassed++;
+        }
+        else
+        {
+            int slot = comp_slot_alloc();
+            if (slot >= 0)
+            {
+                size_t csize = lz_compress(frame.data,
+                                           frame.size,
+                                           comp_pool[slot],
+                                           comp_buf_size);
+
+                if (csize > 0 &&
+                    csize * COMP_GATE_DEN < frame.size * COMP_GATE_NUM)
+                {
+                    // 压缩划算：mmap数据不再需要，立即归还租借
+                    lease_release(frame.buf_index);
+
+                    out.data       = comp_pool[slot];
+                    out.size       = csize;
+                    out.buf_index  = slot;
+                    out.compressed = 1;
+
+                    comp_frames++;
+                    comp_bytes_in += frame.size;
+                    comp_bytes_out += csize;
+                }
+                else
+                {
+                    // 收益不足：透传原始帧并进入旁路窗口
+                    comp_slot_free(slot);
+                    comp_bypassed++;
+                    bypass_left = COMP_BYPASS_FRAMES;
+                }
+            }
+            else
+            {
+                comp_bypassed++;
+            }
+        }
+
+        if (ring_push(&comp_queue, &out) < 0)
+        {
+            // 下游积压，丢弃并释放资源
+            frame_resource_release(&out);
+            continue;
+        }
+
+        uint64_t one = 1;
+        ssize_t n    = write(frame_event_fd, &one, sizeof(one));
+        (void)n;
+    }
+
+    printf("Compressor thread terminated "
+           "(%llu compressed, %llu bypassed, ratio %.2fx)\n",
+           (unsigned long long)comp_frames,
+           (unsigned long long)comp_bypassed,
+           comp_bytes_out ? (double)comp_bytes_in / comp_bytes_out : 1.0);
+    return NULL;
+}
+
+// ========================== 多客户端发送管理 ==========================
+
+/**
+ * @struct frame_ref
+ * @brief 引用计数的共享帧
+ *
+ * 一帧可以同时排在多个客户端的发送队列中，负载数据始终指向
+ * 同一块mmap缓冲区而不做任何拷贝。引用计数归零时才归还缓冲区
+ * 租借。所有字段仅由发送线程访问，无需加锁。
+ */
+struct frame_ref
+{
+    struct frame_data frame;    /**< 帧描述符（含租借凭据） */
+    struct frame_header header; /**< 预构造的协议帧头 */
+    int refcount;               /**< 排队中的客户端引用数 */
+    int in_use;                 /**< 池槽位占用标志 */
+
+    uint8_t* preview;                   /**< 8位预览缓冲区（懒分配） */
+    size_t preview_capacity;            /**< 预览缓冲区容量 */
+    size_t preview_size;                /**< 本帧预览数据大小 */
+    struct frame_header preview_header; /**< 预览流协议帧头 */
+    int has_preview;                    /**< 本帧是否已生成预览数据 */
+};
+
+/**
+ * @struct client_state
+ * @brief 单个客户端的连接与发送状态
+ */
+struct client_state
+{
+    int fd;             /**< 客户端socket，-1表示槽位空闲 */
+    int sndbuf;         /**< socket发送缓冲区大小 */
+    int zerocopy;       /**< 本连接MSG_ZEROCOPY是否生效 */
+    int stream_mode;    /**< 协商的流模式，STREAM_MODE_* */
+    uint32_t stripe_index; /**< 条带流序号（条带化时有效） */
+    uint32_t stripe_count; /**< 条带流总数，<2表示未条带化 */
+    int credit_mode;    /**< 信用流控是否启用（客户端授予过信用） */
+    uint32_t credits;   /**< 剩余发送信用（帧数） */
+    uint8_t ctrl_buf[64]; /**< 控制消息重组缓冲区 */
+    size_t ctrl_len;    /**< 缓冲区中未解析的字节数 */
+    struct frame_ref* queue[CLIENT_QUEUE_DEPTH]; /**< 有界发送队列 */
+    int q_tail;         /**< 队首索引（下一个要发送的帧） */
+    int q_count;        /**< 队列中的帧数 */
+    size_t send_offset; /**< 当前帧已发送字节数（含帧头） */
+    int draining;       /**< queue-all策略：高水位触发后的排空状态 */
+    uint64_t sent_frames;    /**< 完整发送的帧数 */
+    uint64_t dropped_frames; /**< 丢弃的帧总数（各原因之和） */
+    uint64_t dropped_stale;  /**< latest-only策略清空积压丢弃的帧数 */
+    uint64_t dropped_wm;     /**< queue-all策略水位滞回丢弃的帧数 */
+    uint64_t dropped_old;    /**< drop-oldest策略挤掉的旧帧数 */
+    uint64_t dropped_full;   /**< 队列满直接丢弃的新帧数 */
+    uint64_t dropped_credit; /**< 信用耗尽丢弃的帧数 */
+    uint64_t frame_start_ns; /**< 当前帧首字节发送时刻，用于延迟统计 */
+};
+
+/** @brief 共享帧引用池，在途帧数不会超过V4L2缓冲区数 */
+static struct frame_ref frame_refs[MAX_BUFFER_COUNT];
+
+/** @brief 客户端状态表 */
+static struct client_state clients[MAX_CLIENTS];
+
+/**
+ * @brief 释放一个帧引用，归零时归还缓冲区租借
+ *
+ * @param ref 帧引用指针
+ */
+void frame_ref_put(struct frame_ref* ref)
+{
+    if (--ref->refcount <= 0)
+    {
+        frame_resource_release(&ref->frame);
+        ref->in_use = 0;
+    }
+}
+
+/**
+ * @brief 从引用池中取一个空闲槽位
+ *
+ * @return 成功返回槽位指针，池满返回NULL
+ */
+struct frame_ref* frame_ref_get(void)
+{
+    for (int i = 0; i < MAX_BUFFER_COUNT; i++)
+    {
+        if (!frame_refs[i].in_use)
+        {
+            frame_refs[i].in_use   = 1;
+            frame_refs[i].refcount = 0;
+            return &frame_refs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 推进单个客户端的非阻塞发送
+ *
+ * 从上次中断的偏移继续发送当前帧，帧头与负载通过sendmsg()
+ * 向量化聚合；仍有超过发送缓冲区的数据时附带MSG_MORE。
+ * socket写满(EAGAIN)时返回，等待下一次EPOLLOUT继续。
+ *
+ * @param c 客户端状态指针
+ * @return 1=当前帧发送完毕，0=socket暂不可写，-1=连接错误
+ */
+int client_send_progress(struct client_state* c)
+{
+    struct frame_ref* ref = c->queue[c->q_tail];
+
+    // 记录当前帧首次开始发送的时刻
+    if (c->send_offset == 0)
+    {
+        c->frame_start_ns = get_time_ns();
+    }
+
+    // 预览模式客户端发送8位压扩数据及对应帧头
+    int use_preview =
+        (c->stream_mode == STREAM_MODE_PREVIEW8 && ref->has_preview);
+    struct frame_header* hdr = use_preview ? &ref->preview_header : &ref->header;
+    uint8_t* payload     = use_preview ? ref->preview : ref->frame.data;
+    size_t payload_size  = use_preview ? ref->preview_size : ref->frame.size;
+
+    size_t total = sizeof(struct frame_header) + payload_size;
+
+    while (c->send_offset < total)
+    {
+        struct iovec iov[2];
+        int iovcnt = 0;
+
+        if (c->send_offset < sizeof(struct frame_header))
+        {
+            iov[iovcnt].iov_base = (uint8_t*)hdr + c->send_offset;
+            iov[iovcnt].iov_len =
+                sizeof(struct frame_header) - c->send_offset;
+            iovcnt++;
+            iov[iovcnt].iov_base = payload;
+            iov[iovcnt].iov_len  = payload_size;
+            iovcnt++;
+        }
+        else
+        {
+            size_t off           = c->send_offset - sizeof(struct frame_header);
+            iov[iovcnt].iov_base = payload + off;
+            iov[iovcnt].iov_len  = payload_size - off;
+            iovcnt++;
+        }
+
+        struct msghdr msg = {0};
+        msg.msg_iov       = iov;
+        msg.msg_iovlen    = iovcnt;
+
+        int flags = MSG_NOSIGNAL;
+        if ((total - c->send_offset) > (size_t)c->sndbuf)
+        {
+            flags |= MSG_MORE;
+        }
+#ifdef MSG_ZEROCOPY
+        if (c->zerocopy)
+        {
+            flags |= MSG_ZEROCOPY;
+        }
+#endif
+
+        ssize_t result = sendmsg(c->fd, &msg, flags);
+
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+#ifdef MSG_ZEROCOPY
+            if (errno == ENOBUFS && c->zerocopy)
+            {
+                // 完成通知堆积，回收后重试
+                reap_zerocopy_completions(c->fd, ZEROCOPY_REAP_TIMEOUT_MS);
+                continue;
+            }
+#endif
+            return -1;
+        }
+
+        c->send_offset += result;
+    }
+
+#ifdef MSG_ZEROCOPY
+    if (c->zerocopy)
+    {
+        // 等待内核不再引用该帧缓冲区
+        reap_zerocopy_completions(c->fd, ZEROCOPY_REAP_TIMEOUT_MS);
+    }
+#endif
+
+    hist_record(&hist_send, get_time_ns() - c->frame_start_ns);
+    return 1;
 }
 
+// ========================== 统计服务 ==========================
+
+/** @brief 统计服务监听socket（数据端口+1） */
+int stats_listen_fd = -1;
+
+/** @brief 程序启动时刻，用于统计运行时长 */
+uint64_t program_start_ns = 0;
+
 /**
- * @brief 停止V4L2视频流
+ * @brief 格式化一个延迟直方图为JSON片段
  *
- * 通知驱动程序停止图像采集，清空所有队列中的缓冲区。
+ * @param buf 输出缓冲区
+ * @param cap 缓冲区容量
+ * @param name 直方图名称
+ * @param h 直方图指针
+ * @return 写入的字节数
+ */
+int stats_format_hist(char* buf, size_t cap, const char* name,
+                      const struct latency_hist* h)
+{
+    uint64_t avg = h->count > 0 ? h->sum_us / h->count : 0;
+
+    return snprintf(buf,
+                    cap,
+                    "\"%s\":{\"count\":%llu,\"avg_us\":%llu,"
+                    "\"p50_us\":%llu,\"p95_us\":%llu,\"p99_us\":%llu,"
+                    "\"max_us\":%llu}",
+                    name,
+                    (unsigned long long)h->count,
+                    (unsigned long long)avg,
+                    (unsigned long long)hist_percentile(h, 50),
+                    (unsigned long long)hist_percentile(h, 95),
+                    (unsigned long long)hist_percentile(h, 99),
+                    (unsigned long long)h->max_us);
+}
+
+/**
+ * @brief 生成完整的统计JSON文本
  *
- * @param fd 摄像头设备文件描述符
- * @return 成功返回0，失败返回-1
+ * 汇总运行时长、环形队列计数、各客户端发送状态、压缩统计
+ * 与三个阶段延迟直方图。计数器由各工作线程无锁更新，
+ * 此处的读取允许轻微不一致，仅用于观测。
+ *
+ * @param buf 输出缓冲区
+ * @param cap 缓冲区容量
+ * @return 写入的字节数
  */
-int stop_streaming_mp(int fd)
+int stats_format(char* buf, size_t cap)
 {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    size_t off = 0;
+
+    off += snprintf(buf + off,
+                    cap - off,
+                    "{\"uptime_s\":%llu,"
+                    "\"ring\":{\"produced\":%llu,\"consumed\":%llu,"
+                    "\"dropped\":%llu},",
+                    (unsigned long long)((get_time_ns() - program_start_ns) /
+                                         1000000000ULL),
+                    (unsigned long long)frame_queue.produced,
+                    (unsigned long long)frame_queue.consumed,
+                    (unsigned long long)frame_queue.dropped);
+
+    off += snprintf(buf + off, cap - off, "\"clients\":[");
+    int first = 1;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd < 0)
+        {
+            continue;
+        }
+        off += snprintf(buf + off,
+                        cap - off,
+                        "%s{\"slot\":%d,\"sent\":%llu,\"dropped\":%llu,"
+                        "\"dropped_stale\":%llu,\"dropped_watermark\":%llu,"
+                        "\"dropped_oldest\":%llu,\"dropped_full\":%llu,"
+                        "\"dropped_credit\":%llu,\"credits\":%u}",
+                        first ? "" : ",",
+                        i,
+                        (unsigned long long)clients[i].sent_frames,
+                        (unsigned long long)clients[i].dropped_frames,
+                        (unsigned long long)clients[i].dropped_stale,
+                        (unsigned long long)clients[i].dropped_wm,
+                        (unsigned long long)clients[i].dropped_old,
+                        (unsigned long long)clients[i].dropped_full,
+                        (unsigned long long)clients[i].dropped_credit,
+                        clients[i].credits);
+        first = 0;
+    }
+    off += snprintf(buf + off, cap - off, "],");
 
-    if (xioctl(fd, VIDIOC_STREAMOFF, &type) == -1)
+    if (compress_requested)
     {
-        perror("VIDIOC_STREAMOFF failed");
-        return -1;
+        off += snprintf(buf + off,
+                        cap - off,
+                        "\"compression\":{\"compressed\":%llu,"
+                        "\"bypassed\":%llu,\"bytes_in\":%llu,"
+                        "\"bytes_out\":%llu},",
+                        (unsigned long long)comp_frames,
+                        (unsigned long long)comp_bypassed,
+                        (unsigned long long)comp_bytes_in,
+                        (unsigned long long)comp_bytes_out);
     }
 
-    printf("Streaming stopped\n");
-    return 0;
-}
+    off += snprintf(buf + off, cap - off, "\"latency\":{");
+    off += stats_format_hist(buf + off, cap - off, "capture_us", &hist_capture);
+    off += snprintf(buf + off, cap - off, ",");
+    off += stats_format_hist(buf + off, cap - off, "queue_us", &hist_queue);
+    off += snprintf(buf + off, cap - off, ",");
+    off += stats_format_hist(buf + off, cap - off, "send_us", &hist_send);
+    off += snprintf(buf + off, cap - off, "}}\n");
 
-// ========================== 网络通信函数 ==========================
+    return (int)off;
+}
 
 /**
- * @brief 创建TCP服务器
+ * @brief 创建统计服务监听socket
  *
- * 创建并配置TCP服务器socket，绑定到指定的IP地址和端口，
- * 开始监听客户端连接请求。
+ * 监听数据端口+1，每个连接发送一份统计JSON后立即关闭，
+ * 方便用nc或curl随时抓取，不干扰数据面。
  *
- * @param port 服务器监听端口
- * @return 成功返回服务器socket文件描述符，失败返回-1
+ * @param port 统计服务监听端口
+ * @return 成功返回0，失败返回-1
  */
-int create_server(int port)
+int create_stats_socket(int port)
 {
-    int fd;
     struct sockaddr_in addr;
     int opt = 1;
 
-    fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0)
+    stats_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (stats_listen_fd < 0)
     {
-        perror("socket failed");
+        perror("stats socket failed");
         return -1;
     }
 
-    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
-    {
-        perror("setsockopt failed");
-        close(fd);
-        return -1;
-    }
+    setsockopt(stats_listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
     memset(&addr, 0, sizeof(addr));
     addr.sin_family      = AF_INET;
     addr.sin_addr.s_addr = inet_addr(DEFAULT_SERVER_IP);
     addr.sin_port        = htons(port);
 
-    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    if (bind(stats_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(stats_listen_fd, 2) < 0)
     {
-        perror("bind failed");
-        close(fd);
+        perror("stats bind/listen failed");
+        close(stats_listen_fd);
+        stats_listen_fd = -1;
         return -1;
     }
 
-    if (listen(fd, 1) < 0)
+    printf("Stats server listening on %s:%d\n", DEFAULT_SERVER_IP, port);
+    return 0;
+}
+
+/**
+ * @brief 统计服务线程函数
+ *
+ * 接受连接、写出统计JSON、关闭连接的简单请求-响应循环。
+ * 使用poll超时轮询以便响应退出信号。
+ *
+ * @param arg 线程参数（当前未使用）
+ * @return 线程退出时返回NULL
+ */
+void* stats_server_thread(void* arg)
+{
+    (void)arg;
+
+    while (running)
     {
-        perror("listen failed");
+        struct pollfd pfd = {.fd = stats_listen_fd, .events = POLLIN};
+        int r             = poll(&pfd, 1, 500);
+
+        if (r <= 0)
+        {
+            continue;
+        }
+
+        int fd = accept(stats_listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        char blob[4096];
+        int len = stats_format(blob, sizeof(blob));
+
+        ssize_t n = send(fd, blob, len, MSG_NOSIGNAL);
+        (void)n;
         close(fd);
-        return -1;
     }
 
-    printf("Server listening on %s:%d\n", DEFAULT_SERVER_IP, port);
-    return fd;
+    return NULL;
 }
 
+// ========================== 多线程处理函数 ==========================
+
+/** @brief epoll事件标识：监听socket */
+#define EV_TAG_SERVER 0xFFFFFFFFu
+
+/** @brief epoll事件标识：帧到达eventfd */
+#define EV_TAG_FRAME 0xFFFFFFFEu
+
 /**
- * @struct frame_header
- * @brief 数据帧头部结构
+ * @brief 更新客户端的epoll事件兴趣
  *
- * 定义传输协议的帧头格式，包含帧的元数据信息。
- * 使用packed属性确保结构体内存布局的一致性。
+ * 始终监听EPOLLIN以检测断开，仅在发送队列非空时监听EPOLLOUT，
+ * 避免空闲客户端触发忙唤醒。
+ *
+ * @param epfd epoll实例文件描述符
+ * @param idx 客户端槽位索引
  */
-struct frame_header
+void client_update_interest(int epfd, int idx)
 {
-    uint32_t magic;       /**< 魔数标识：0xDEADBEEF */
-    uint32_t frame_id;    /**< 帧序号 */
-    uint32_t width;       /**< 图像宽度 */
-    uint32_t height;      /**< 图像高度 */
-    uint32_t pixfmt;      /**< 像素格式 */
-    uint32_t size;        /**< 数据大小 */
-    uint64_t timestamp;   /**< 时间戳 */
-    uint32_t reserved[2]; /**< 保留字段 */
-} __attribute__((packed));
+    struct epoll_event ev = {0};
+    ev.events             = EPOLLIN;
+    ev.data.u32           = idx;
+
+    if (clients[idx].q_count > 0)
+    {
+        ev.events |= EPOLLOUT;
+    }
+
+    epoll_ctl(epfd, EPOLL_CTL_MOD, clients[idx].fd, &ev);
+}
+
+/**
+ * @brief 接受新的客户端连接
+ *
+ * 为连接分配空闲槽位、设置非阻塞模式、查询发送缓冲区大小
+ * 并按需启用零拷贝，随后注册到epoll实例。没有空闲槽位时
+ * 直接拒绝连接。
+ *
+ * @param epfd epoll实例文件描述符
+ */
+void accept_new_client(int epfd)
+{
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+
+    int fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+    if (fd < 0)
+    {
+        if (running && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            perror("accept failed");
+        }
+        return;
+    }
+
+    int idx = -1;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd < 0)
+        {
+            idx = i;
+            break;
+        }
+    }
+
+    if (idx < 0)
+    {
+        printf("Rejecting client from %s: all %d slots in use\n",
+               inet_ntoa(client_addr.sin_addr),
+               MAX_CLIENTS);
+        close(fd);
+        return;
+    }
+
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl >= 0)
+    {
+        fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+    }
+
+    struct client_state* c = &clients[idx];
+    memset(c, 0, sizeof(*c));
+    c->fd     = fd;
+    c->sndbuf = CHUNK_SIZE;
+
+    // 查询发送缓冲区大小，用于MSG_MORE分段判断
+    socklen_t optlen = sizeof(c->sndbuf);
+    if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &c->sndbuf, &optlen) < 0 ||
+        c->sndbuf <= 0)
+    {
+        c->sndbuf = CHUNK_SIZE;
+    }
+
+    // 按需启用零拷贝发送
+#ifdef SO_ZEROCOPY
+    if (zerocopy_requested)
+    {
+        int one = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)
+        {
+            c->zerocopy = 1;
+        }
+    }
+#endif
+
+    struct epoll_event ev = {0};
+    ev.events             = EPOLLIN;
+    ev.data.u32           = idx;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        perror("epoll_ctl ADD client failed");
+        close(fd);
+        c->fd = -1;
+        return;
+    }
+
+    clients_active++;
+    printf("Client %d connected from %s%s (%d active)\n",
+           idx,
+           inet_ntoa(client_addr.sin_addr),
+           c->zerocopy ? " [zerocopy]" : "",
+           clients_active);
+}
+
+/**
+ * @brief 断开客户端并释放其排队的帧引用
+ *
+ * @param epfd epoll实例文件描述符
+ * @param idx 客户端槽位索引
+ */
+void disconnect_client(int epfd, int idx)
+{
+    struct client_state* c = &clients[idx];
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+
+    while (c->q_count > 0)
+    {
+        frame_ref_put(c->queue[c->q_tail]);
+        c->q_tail = (c->q_tail + 1) % CLIENT_QUEUE_DEPTH;
+        c->q_count--;
+    }
+
+    clients_active--;
+    printf("Client %d disconnected (%llu frames sent, %llu dropped, "
+           "%d active)\n",
+           idx,
+           (unsigned long long)c->sent_frames,
+           (unsigned long long)c->dropped_frames,
+           clients_active);
+}
+
+/**
+ * @brief 按丢帧策略将新帧加入单个客户端的发送队列
+ *
+ * latest-only清空所有尚未开始发送的积压帧后排队新帧；
+ * queue-all在队列达到高水位后持续丢弃新帧，直到排空至
+ * 低水位才恢复（滞回避免在水位线附近抖动）；drop-oldest
+ * 队列满时挤掉最旧的未发送帧为新帧腾位。每种丢弃原因
+ * 独立计数，通过统计服务暴露。
+ *
+ * @param epfd epoll实例文件描述符
+ * @param idx 客户端槽位索引
+ * @param ref 待排队的帧引用
+ */
+void client_enqueue_frame(int epfd, int idx, struct frame_ref* ref)
+{
+    struct client_state* c = &clients[idx];
+
+    // 条带化连接按frame_id轮转，只接收属于本路流的帧
+    if (c->stripe_count > 1 &&
+        ref->header.frame_id % c->stripe_count != c->stripe_index)
+    {
+        return;
+    }
+
+    // 信用流控：信用耗尽时直接丢弃新帧，避免TCP背压阻塞采集
+    if (c->credit_mode && c->credits == 0)
+    {
+        c->dropped_credit++;
+        c->dropped_frames++;
+        return;
+    }
+
+    if (drop_policy == DROP_POLICY_LATEST_ONLY)
+    {
+        // 只保留最新：丢掉所有未开始发送的积压帧
+        int keep = (c->send_offset > 0) ? 1 : 0;
+        while (c->q_count > keep)
+        {
+            int last = (c->q_tail + c->q_count - 1) % CLIENT_QUEUE_DEPTH;
+            frame_ref_put(c->queue[last]);
+            c->q_count--;
+            c->dropped_stale++;
+            c->dropped_frames++;
+            if (c->credit_mode)
+            {
+                c->credits++; // 未发送即丢弃，退还信用
+            }
+        }
+    }
+    else if (drop_policy == DROP_POLICY_QUEUE_ALL)
+    {
+        // 水位滞回：高水位进入排空状态，降到低水位才恢复排队
+        if (c->draining && c->q_count <= wm_low)
+        {
+            c->draining = 0;
+        }
+        else if (!c->draining && c->q_count >= wm_high)
+        {
+            c->draining = 1;
+        }
+
+        if (c->draining)
+        {
+            c->dropped_wm++;
+            c->dropped_frames++;
+            return;
+        }
+    }
+    else if (drop_policy == DROP_POLICY_OLDEST &&
+             c->q_count >= CLIENT_QUEUE_DEPTH)
+    {
+        if (c->send_offset == 0)
+        {
+            // 队首尚未开始发送，直接丢弃
+            frame_ref_put(c->queue[c->q_tail]);
+            c->q_tail = (c->q_tail + 1) % CLIENT_QUEUE_DEPTH;
+            c->q_count--;
+        }
+        else
+        {
+            // 队首发送中不能动，丢其后最旧的一帧并前移其余帧
+            int victim = (c->q_tail + 1) % CLIENT_QUEUE_DEPTH;
+            frame_ref_put(c->queue[victim]);
+            for (int k = 1; k < c->q_count - 1; k++)
+            {
+                int dst       = (c->q_tail + k) % CLIENT_QUEUE_DEPTH;
+                int src       = (c->q_tail + k + 1) % CLIENT_QUEUE_DEPTH;
+                c->queue[dst] = c->queue[src];
+            }
+            c->q_count--;
+        }
+        c->dropped_old++;
+        c->dropped_frames++;
+        if (c->credit_mode)
+        {
+            c->credits++; // 未发送即丢弃，退还信用
+        }
+    }
+
+    if (c->q_count >= CLIENT_QUEUE_DEPTH)
+    {
+        // 队列仍满（慢客户端），丢弃新帧
+        c->dropped_full++;
+        c->dropped_frames++;
+        return;
+    }
+
+    int q_head       = (c->q_tail + c->q_count) % CLIENT_QUEUE_DEPTH;
+    c->queue[q_head] = ref;
+    c->q_count++;
+    ref->refcount++;
+    if (c->credit_mode)
+    {
+        c->credits--; // 排队即消耗，客户端每收到一帧补发一个
+    }
+    client_update_interest(epfd, idx);
+}
+
+/**
+ * @brief 将环形队列中的新帧分发到各客户端发送队列
+ *
+ * 负载不做拷贝：每个客户端队列只保存指向共享frame_ref的指针，
+ * 引用计数保证所有客户端发送完毕后才归还缓冲区租借。
+ * 某个客户端积压时仅按该客户端的丢帧策略丢帧，不影响其他客户端。
+ *
+ * @param epfd epoll实例文件描述符
+ */
+void fanout_frames(int epfd)
+{
+    struct frame_data frame;
+
+    while (ring_pop(sender_queue, &frame) == 0)
+    {
+        // DQBUF到发送线程取走之间的排队延迟
+        hist_record(&hist_queue, get_time_ns() - frame.timestamp);
+
+        struct frame_ref* ref = frame_ref_get();
+        if (!ref)
+        {
+            // 引用池耗尽（理论上不会发生：在途帧数受缓冲区数限制）
+            frame_resource_release(&frame);
+            continue;
+        }
+
+        ref->frame  = frame;
+        ref->header = (struct frame_header){.magic     = 0xDEADBEEF,
+                                            .frame_id  = frame.frame_id,
+                                            .width     = g_width,
+                                            .height    = g_height,
+                                            .pixfmt    = PIXELFORMAT,
+                                            .size      = frame.size,
+                                            .timestamp = frame.timestamp,
+                                            .reserved  = {0, 0}};
+        ref->header.reserved[0] = frame.compressed ? 1 : 0;
+        if (crc_requested)
+        {
+            // 对线上传输的负载（压缩后）计算校验和
+            ref->header.reserved[1] = crc32c_compute(frame.data, frame.size);
+        }
+        ref->has_preview        = 0;
+
+        // 有预览模式客户端时，压扩一次8位副本供所有预览客户端共享
+        int want_preview = 0;
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            if (clients[i].fd >= 0 &&
+                clients[i].stream_mode == STREAM_MODE_PREVIEW8)
+            {
+                want_preview = 1;
+                break;
+            }
+        }
+
+        // 压缩帧无法在设备端压扩，预览客户端收到压缩的原始流
+        if (want_preview && !frame.compressed && frame.size % 5 == 0)
+        {
+            size_t need = frame.size / 5 * 4;
+
+            if (ref->preview_capacity < need)
+            {
+                free(ref->preview);
+                ref->preview          = malloc(need);
+                ref->preview_capacity = ref->preview ? need : 0;
+            }
+
+            if (ref->preview)
+            {
+                ref->preview_size =
+                    compand_sbggr10_to8(frame.data, ref->preview, frame.size);
+                ref->preview_header        = ref->header;
+                ref->preview_header.pixfmt = V4L2_PIX_FMT_SBGGR8;
+                ref->preview_header.size   = ref->preview_size;
+                if (crc_requested)
+                {
+                    ref->preview_header.reserved[1] =
+                        crc32c_compute(ref->preview, ref->preview_size);
+                }
+                ref->has_preview           = 1;
+            }
+        }
+
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            if (clients[i].fd < 0)
+            {
+                continue;
+            }
+
+            // 慢客户端按丢帧策略自己丢帧，不拖累其他客户端
+            client_enqueue_frame(epfd, i, ref);
+        }
+
+        if (ref->refcount == 0)
+        {
+            // 没有客户端接收该帧，立即归还
+            frame_resource_release(&frame);
+            ref->in_use = 0;
+        }
+    }
+}
 
 /**
- * @brief 发送图像帧数据到客户端
+ * @brief 解析客户端控制字节流
  *
- * 将图像数据按照自定义协议发送给TCP客户端。
- * 先发送帧头，再分块发送图像数据，提高传输效率。
+ * 三类控制消息（流模式、条带加入、信用授予）会背靠背发出并
+ * 在TCP流中合并进同一次recv，必须按游标顺序解析：读取游标处
+ * 的魔数分发到对应消息，按该消息的长度推进。不完整的尾部
+ * 消息保留在重组缓冲区中等下次EPOLLIN续接；未知魔数则丢弃
+ * 剩余字节，避免错位后永久失步。
  *
- * @param client_fd 客户端socket文件描述符
- * @param data 图像数据指针
- * @param size 图像数据大小
- * @param frame_id 帧序号
- * @param timestamp 时间戳
- * @return 成功返回0，失败返回-1
+ * @param tag 客户端槽位索引
  */
-int send_frame(int client_fd,
-               void* data,
-               size_t size,
-               uint32_t frame_id,
-               uint64_t timestamp)
-{
-    struct frame_header header = {.magic     = 0xDEADBEEF,
-                                  .frame_id  = frame_id,
-                                  .width     = WIDTH,
-                                  .height    = HEIGHT,
-                                  .pixfmt    = PIXELFORMAT,
-                                  .size      = size,
-                                  .timestamp = timestamp,
-                                  .reserved  = {0, 0}};
-
-    // 发送帧头
-    if (send(client_fd, &header, sizeof(header), MSG_NOSIGNAL) !=
-        sizeof(header))
+void client_parse_ctrl(uint32_t tag)
+{
+    struct client_state* c = &clients[tag];
+    size_t off = 0;
+
+    while (c->ctrl_len - off >= sizeof(uint32_t))
     {
-        return -1;
-    }
+        uint32_t magic;
+        memcpy(&magic, c->ctrl_buf + off, sizeof(magic));
 
-    // 分块发送数据
-    size_t sent  = 0;
-    uint8_t* ptr = (uint8_t*)data;
+        size_t need;
+        if (magic == CTRL_MAGIC)
+        {
+            need = sizeof(struct client_ctrl);
+        }
+        else if (magic == STRIPE_MAGIC)
+        {
+            need = sizeof(struct stripe_ctrl);
+        }
+        else if (magic == CREDIT_MAGIC)
+        {
+            need = sizeof(struct credit_ctrl);
+        }
+        else
+        {
+            c->ctrl_len = 0;
+            return;
+        }
 
-    while (sent < size && running)
-    {
-        size_t to_send =
-            (size - sent) > CHUNK_SIZE ? CHUNK_SIZE : (size - sent);
-        ssize_t result = send(client_fd, ptr + sent, to_send, MSG_NOSIGNAL);
+        if (c->ctrl_len - off < need)
+        {
+            break; // 尾部消息不完整，等待后续字节
+        }
 
-        if (result <= 0)
+        if (magic == CTRL_MAGIC)
         {
-            return -1;
+            struct client_ctrl ctrl;
+            memcpy(&ctrl, c->ctrl_buf + off, sizeof(ctrl));
+
+            if (ctrl.mode == STREAM_MODE_RAW10 ||
+                ctrl.mode == STREAM_MODE_PREVIEW8)
+            {
+                c->stream_mode = ctrl.mode;
+                printf("Client %u stream mode: %s\n",
+                       tag,
+                       ctrl.mode == STREAM_MODE_PREVIEW8 ? "8-bit preview"
+                                                         : "10-bit raw");
+            }
+        }
+        else if (magic == STRIPE_MAGIC)
+        {
+            struct stripe_ctrl sc;
+            memcpy(&sc, c->ctrl_buf + off, sizeof(sc));
+
+            if (sc.count >= 2 && sc.count <= MAX_CLIENTS &&
+                sc.index < sc.count)
+            {
+                c->stripe_index = sc.index;
+                c->stripe_count = sc.count;
+                printf("Client %u joined stripe stream %u/%u\n",
+                       tag,
+                       sc.index,
+                       sc.count);
+            }
+        }
+        else
+        {
+            struct credit_ctrl cc;
+            memcpy(&cc, c->ctrl_buf + off, sizeof(cc));
+
+            if (cc.credits > 0)
+            {
+                if (!c->credit_mode)
+                {
+                    printf("Client %u credit flow control enabled "
+                           "(window %u)\n",
+                           tag,
+                           cc.credits);
+                }
+                c->credit_mode = 1;
+                c->credits += cc.credits;
+            }
         }
 
-        sent += result;
+        off += need;
     }
 
-    return 0;
+    // 不完整的尾部移到缓冲区头部，等待后续字节
+    if (off > 0)
+    {
+        memmove(c->ctrl_buf, c->ctrl_buf + off, c->ctrl_len - off);
+        c->ctrl_len -= off;
+    }
 }
 
-// ========================== 多线程处理函数 ==========================
-
 /**
  * @brief USB数据发送线程函数
  *
- * 专门负责网络数据传输的工作线程。主要功能包括：
- * 1. 监听并接受客户端连接
- * 2. 等待采集线程产生的新帧数据
- * 3. 将图像数据发送给已连接的客户端
- * 4. 处理客户端断开连接的情况
+ * epoll驱动的多客户端发送事件循环。主要功能包括：
+ * 1. 非阻塞接受新客户端连接（最多MAX_CLIENTS个）
+ * 2. 响应帧到达事件，将共享帧分发到各客户端发送队列
+ * 3. 在EPOLLOUT事件中推进各客户端的非阻塞发送
+ * 4. 检测并清理断开的客户端
  *
- * 该线程与主采集线程通过条件变量和互斥锁进行同步，
- * 确保数据传输的线程安全性。
+ * 每个客户端拥有独立的有界发送队列，慢客户端只会丢弃
+ * 自己的帧而不会阻塞其他客户端或采集线程。
  *
  * @param arg 线程参数（当前未使用）
  * @return 线程退出时返回NULL
  */
 void* usb_sender_thread(void* arg)
 {
-    printf("USB sender thread started\n");
+    printf("USB sender thread started (epoll, max %d clients)\n", MAX_CLIENTS);
+
+    // 发送线程优先级略低于采集线程，保证DQBUF优先
+    setup_realtime_sched("Sender thread", rt_prio - 1);
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        clients[i].fd = -1;
+    }
+
+    int epfd = epoll_create1(0);
+    if (epfd < 0)
+    {
+        perror("epoll_create1 failed");
+        running = 0;
+        return NULL;
+    }
+
+    struct epoll_event ev = {0};
+    ev.events             = EPOLLIN;
+    ev.data.u32           = EV_TAG_SERVER;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, server_fd, &ev);
+
+    ev.events   = EPOLLIN;
+    ev.data.u32 = EV_TAG_FRAME;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, frame_event_fd, &ev);
 
     while (running)
     {
-        // 等待客户端连接
-        if (!client_connected)
+        struct epoll_event events[MAX_CLIENTS + 2];
+        int n = epoll_wait(epfd, events, MAX_CLIENTS + 2, 100);
+
+        if (n < 0)
+        {
+            if (errno != EINTR)
+            {
+                perror("epoll_wait failed");
+                break;
+            }
+            continue;
+        }
+
+        for (int e = 0; e < n; e++)
         {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
+            uint32_t tag = events[e].data.u32;
 
-            printf("Waiting for client connection...\n");
-            client_fd =
-                accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+            if (tag == EV_TAG_SERVER)
+            {
+                accept_new_client(epfd);
+                continue;
+            }
 
-            if (client_fd < 0)
+            if (tag == EV_TAG_FRAME)
             {
-                if (running)
-                {
-                    perror("accept failed");
-                }
+                uint64_t cnt;
+                ssize_t r = read(frame_event_fd, &cnt, sizeof(cnt));
+                (void)r;
+                fanout_frames(epfd);
                 continue;
             }
 
-            printf("Client connected from %s\n",
-                   inet_ntoa(client_addr.sin_addr));
-            client_connected = 1;
-        }
+            struct client_state* c = &clients[tag];
+            if (c->fd < 0)
+            {
+                continue;
+            }
 
-        // 等待新帧数据
-        pthread_mutex_lock(&frame_mutex);
-        while (current_frame.data == NULL && running)
-        {
-            pthread_cond_wait(&frame_ready, &frame_mutex);
-        }
+            if (events[e].events & (EPOLLHUP | EPOLLERR))
+            {
+                disconnect_client(epfd, tag);
+                continue;
+            }
 
-        if (current_frame.data && running)
-        {
-            // 发送帧数据
-            if (send_frame(client_fd,
-                           current_frame.data,
-                           current_frame.size,
-                           current_frame.frame_id,
-                           current_frame.timestamp) < 0)
+            if (events[e].events & EPOLLIN)
             {
-                printf("Client disconnected (frame %d)\n",
-                       current_frame.frame_id);
-                close(client_fd);
-                client_connected = 0;
+                // 读入控制字节流，收到0或错误视为断开
+                ssize_t r = recv(c->fd,
+                                 c->ctrl_buf + c->ctrl_len,
+                                 sizeof(c->ctrl_buf) - c->ctrl_len,
+                                 MSG_DONTWAIT);
+                if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                {
+                    disconnect_client(epfd, tag);
+                    continue;
+                }
 
-                // 清理当前帧数据，避免内存泄漏
-                current_frame.data = NULL;
+                if (r > 0)
+                {
+                    c->ctrl_len += (size_t)r;
+                    client_parse_ctrl(tag);
+                }
             }
-            else
+
+            if ((events[e].events & EPOLLOUT) && c->q_count > 0)
             {
-                // 发送成功，清理当前帧
-                current_frame.data = NULL;
+                int result = client_send_progress(c);
+
+                if (result < 0)
+                {
+                    disconnect_client(epfd, tag);
+                    continue;
+                }
+
+                if (result == 1)
+                {
+                    // 当前帧发送完毕，推进队列
+                    frame_ref_put(c->queue[c->q_tail]);
+                    c->q_tail = (c->q_tail + 1) % CLIENT_QUEUE_DEPTH;
+                    c->q_count--;
+                    c->send_offset = 0;
+                    c->sent_frames++;
+                    client_update_interest(epfd, tag);
+                }
             }
         }
+    }
 
-        pthread_mutex_unlock(&frame_mutex);
+    // 清理所有客户端连接
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd >= 0)
+        {
+            disconnect_client(epfd, i);
+        }
     }
 
-    if (client_connected)
+    // 释放预览缓冲区
+    for (int i = 0; i < MAX_BUFFER_COUNT; i++)
     {
-        close(client_fd);
+        free(frame_refs[i].preview);
+        frame_refs[i].preview          = NULL;
+        frame_refs[i].preview_capacity = 0;
     }
 
+    close(epfd);
     printf("USB sender thread terminated\n");
     return NULL;
 }
@@ -653,12 +2802,12 @@ void* usb_sender_thread(void* arg)
  * 程序的核心处理循环，负责连续采集摄像头图像数据。主要流程：
  * 1. 使用select()等待摄像头数据就绪
  * 2. 从V4L2队列中取出包含图像的缓冲区
- * 3. 如有客户端连接，通知发送线程处理数据
+ * 3. 如有客户端连接，将帧描述符入队给发送线程
  * 4. 将缓冲区重新加入队列供下次使用
  * 5. 统计并显示性能信息（帧率、数据量等）
  *
- * 该函数实现了生产者-消费者模式，采集线程作为生产者，
- * 发送线程作为消费者，通过共享内存和同步原语协调工作。
+ * 该函数实现了生产者-消费者模式，采集线程作为无锁环形
+ * 队列的唯一生产者，入队永不阻塞，发送线程负责清空积压。
  *
  * @param fd 摄像头设备文件描述符
  * @param buffers 缓冲区数组
@@ -675,13 +2824,26 @@ int capture_loop(int fd, struct buffer* buffers, int buffer_count)
 
     while (running)
     {
-        // 等待数据可用
+        // 归还发送线程释放的缓冲区
+        lease_requeue_pending(fd);
+
+        // 等待摄像头数据或缓冲区归还事件
         fd_set fds;
         FD_ZERO(&fds);
         FD_SET(fd, &fds);
+        int max_fd = fd;
+
+        if (lease_mgr.event_fd >= 0)
+        {
+            FD_SET(lease_mgr.event_fd, &fds);
+            if (lease_mgr.event_fd > max_fd)
+            {
+                max_fd = lease_mgr.event_fd;
+            }
+        }
 
         struct timeval tv = {.tv_sec = 1, .tv_usec = 0};
-        int r             = select(fd + 1, &fds, NULL, NULL, &tv);
+        int r             = select(max_fd + 1, &fds, NULL, NULL, &tv);
 
         if (r == -1)
         {
@@ -698,10 +2860,25 @@ int capture_loop(int fd, struct buffer* buffers, int buffer_count)
             continue;
         }
 
+        // 缓冲区归还事件：清空eventfd计数并立即重新入队
+        if (lease_mgr.event_fd >= 0 && FD_ISSET(lease_mgr.event_fd, &fds))
+        {
+            uint64_t cnt;
+            ssize_t n = read(lease_mgr.event_fd, &cnt, sizeof(cnt));
+            (void)n;
+            lease_requeue_pending(fd);
+        }
+
+        if (!FD_ISSET(fd, &fds))
+        {
+            continue;
+        }
+
         // 出队缓冲区
         int buf_index;
         size_t bytes_used;
-        if (dequeue_buffer_mp(fd, &buf_index, &bytes_used) < 0)
+        uint64_t hw_timestamp;
+        if (dequeue_buffer_mp(fd, &buf_index, &bytes_used, &hw_timestamp) < 0)
         {
             if (errno != EAGAIN && errno != EINTR)
             {
@@ -714,20 +2891,37 @@ int capture_loop(int fd, struct buffer* buffers, int buffer_count)
 
         uint64_t timestamp = get_time_ns();
 
-        // 通知USB发送线程（仅在有客户端时）
-        if (client_connected)
+        // 传感器就绪到DQBUF的延迟（驱动时间戳源不可用时跳过）
+        if (hw_timestamp > 0 && hw_timestamp < timestamp)
+        {
+            hist_record(&hist_capture, timestamp - hw_timestamp);
+        }
+
+        // 入队给USB发送线程（仅在有客户端时）：入队成功则缓冲区
+        // 转入租借状态，由发送线程发送完毕后归还；入队失败或无
+        // 客户端时立即重新入队
+        int leased = 0;
+        if (clients_active > 0)
         {
-            pthread_mutex_lock(&frame_mutex);
-            current_frame.data      = buffers[buf_index].start[0];
-            current_frame.size      = bytes_used;
-            current_frame.frame_id  = frame_counter;
-            current_frame.timestamp = timestamp;
-            pthread_cond_signal(&frame_ready);
-            pthread_mutex_unlock(&frame_mutex);
+            struct frame_data frame = {.data = buffers[buf_index].start[0],
+                                       .size      = bytes_used,
+                                       .frame_id  = frame_counter,
+                                       .timestamp = timestamp,
+                                       .buf_index = buf_index};
+
+            if (ring_push(&frame_queue, &frame) == 0)
+            {
+                leased = 1;
+
+                // 唤醒下游（压缩线程或发送线程的epoll_wait）
+                uint64_t one = 1;
+                ssize_t n    = write(capture_notify_fd, &one, sizeof(one));
+                (void)n;
+            }
         }
 
-        // 重新队列缓冲区
-        if (queue_buffer_mp(fd, buf_index) < 0)
+        // 重新队列缓冲区（租借中的缓冲区由发送线程归还）
+        if (!leased && queue_buffer_mp(fd, buf_index) < 0)
         {
             perror("queue failed");
             // 尝试恢复而不是直接退出
@@ -742,11 +2936,15 @@ int capture_loop(int fd, struct buffer* buffers, int buffer_count)
         uint64_t current_time = get_time_ns();
         if (current_time - last_stats_time >= 5000000000ULL)
         {  // 5秒
-            printf("Frame %d, FPS: %d, Bytes: %zu, Connected: %s\n",
+            printf("Frame %d, FPS: %d, Bytes: %zu, Clients: %d, "
+                   "Ring: %llu produced / %llu consumed / %llu dropped\n",
                    frame_counter,
                    frames_in_second / 5,
                    bytes_used,
-                   client_connected ? "YES" : "NO");
+                   clients_active,
+                   (unsigned long long)frame_queue.produced,
+                   (unsigned long long)frame_queue.consumed,
+                   (unsigned long long)frame_queue.dropped);
             frames_in_second = 0;
             last_stats_time  = current_time;
         }
@@ -784,13 +2982,117 @@ int main(int argc, char* argv[])
     int port           = DEFAULT_PORT;
     int fd             = -1;
     struct v4l2_format fmt;
-    struct buffer buffers[BUFFER_COUNT];
+    struct buffer buffers[MAX_BUFFER_COUNT];
     int buffer_count;
     pthread_t usb_thread;
+    pthread_t comp_thread;
+    pthread_t dmabuf_thread;
+    pthread_t stats_thread;
+    int comp_thread_started   = 0;
+    int dmabuf_thread_started = 0;
+    int stats_thread_started  = 0;
 
-    if (argc > 1)
+    uint32_t ring_depth = DEFAULT_RING_DEPTH;
+    int req_buffers     = DEFAULT_BUFFER_COUNT;
+
+    for (int i = 1; i < argc; i++)
     {
-        port = atoi(argv[1]);
+        if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+        {
+            ring_depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            req_buffers = atoi(argv[++i]);
+            if (req_buffers < 2)
+            {
+                req_buffers = 2;
+            }
+            else if (req_buffers > MAX_BUFFER_COUNT)
+            {
+                req_buffers = MAX_BUFFER_COUNT;
+            }
+        }
+        else if (strcmp(argv[i], "-z") == 0)
+        {
+            zerocopy_requested = 1;
+        }
+        else if (strcmp(argv[i], "-C") == 0)
+        {
+            compress_requested = 1;
+        }
+        else if (strcmp(argv[i], "-E") == 0 && i + 1 < argc)
+        {
+            dmabuf_sock_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+        {
+            const char* policy = argv[++i];
+            if (strcmp(policy, "latest-only") == 0)
+            {
+                drop_policy = DROP_POLICY_LATEST_ONLY;
+            }
+            else if (strcmp(policy, "drop-oldest") == 0)
+            {
+                drop_policy = DROP_POLICY_OLDEST;
+            }
+            else if (strcmp(policy, "queue-all") == 0)
+            {
+                drop_policy = DROP_POLICY_QUEUE_ALL;
+            }
+            else
+            {
+                printf("Unknown drop policy: %s "
+                       "(latest-only|queue-all|drop-oldest)\n",
+                       policy);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            negotiate_requested = 1;
+        }
+        else if (strcmp(argv[i], "--crc") == 0)
+        {
+            crc_requested = 1;
+        }
+        else if (strcmp(argv[i], "--rt-prio") == 0 && i + 1 < argc)
+        {
+            rt_prio = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-rt") == 0)
+        {
+            rt_enabled = 0;
+        }
+        else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc)
+        {
+            // queue-all策略水位，格式：高水位,低水位
+            if (sscanf(argv[++i], "%d,%d", &wm_high, &wm_low) != 2)
+            {
+                printf("Invalid watermarks (expected high,low)\n");
+                return -1;
+            }
+            if (wm_high < 1)
+            {
+                wm_high = 1;
+            }
+            else if (wm_high > CLIENT_QUEUE_DEPTH)
+            {
+                wm_high = CLIENT_QUEUE_DEPTH;
+            }
+            if (wm_low < 0)
+            {
+                wm_low = 0;
+            }
+            else if (wm_low >= wm_high)
+            {
+                wm_low = wm_high - 1;
+            }
+        }
+        else
+        {
+            port = atoi(argv[i]);
+        }
     }
 
     printf("V4L2 USB RAW Image Streamer for Luckfox Pico Mini B\n");
@@ -798,6 +3100,58 @@ int main(int argc, char* argv[])
     printf("Port: %d\n", port);
     printf("Server IP: %s\n", DEFAULT_SERVER_IP);
 
+    ring_init(&frame_queue, ring_depth);
+    printf("Frame ring depth: %u\n", frame_queue.depth);
+    printf("Buffer count: %d\n", req_buffers);
+
+    if (crc_requested)
+    {
+        crc32c_init();
+        printf("Payload CRC32C: enabled\n");
+    }
+
+    static const char* policy_names[] = {"queue-all", "latest-only",
+                                         "drop-oldest"};
+    printf("Drop policy: %s", policy_names[drop_policy]);
+    if (drop_policy == DROP_POLICY_QUEUE_ALL)
+    {
+        printf(" (watermarks %d/%d)", wm_high, wm_low);
+    }
+    printf("\n");
+
+    // 创建缓冲区归还通知eventfd
+    lease_mgr.event_fd = eventfd(0, EFD_NONBLOCK);
+    if (lease_mgr.event_fd < 0)
+    {
+        perror("eventfd failed");
+        return -1;
+    }
+
+    // 创建帧到达通知eventfd
+    frame_event_fd = eventfd(0, EFD_NONBLOCK);
+    if (frame_event_fd < 0)
+    {
+        perror("eventfd failed");
+        close(lease_mgr.event_fd);
+        return -1;
+    }
+
+    // 压缩启用时采集线程唤醒压缩线程，否则直接唤醒发送线程
+    capture_notify_fd = frame_event_fd;
+    if (compress_requested)
+    {
+        ring_init(&comp_queue, ring_depth);
+        comp_wake_fd = eventfd(0, EFD_NONBLOCK);
+        if (comp_wake_fd < 0)
+        {
+            perror("eventfd failed");
+            return -1;
+        }
+        capture_notify_fd = comp_wake_fd;
+        sender_queue      = &comp_queue;
+        printf("Compression pipeline: enabled\n");
+    }
+
     // 检查系统资源
     printf("Checking system resources...\n");
     system(
@@ -816,6 +3170,20 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // 统计服务使用数据端口+1，失败时不影响数据面，仅告警
+    program_start_ns = get_time_ns();
+    if (create_stats_socket(port + 1) == 0)
+    {
+        if (pthread_create(&stats_thread, NULL, stats_server_thread, NULL) == 0)
+        {
+            stats_thread_started = 1;
+        }
+        else
+        {
+            perror("Failed to create stats thread");
+        }
+    }
+
     // 打开摄像头设备
     fd = open(device, O_RDWR | O_NONBLOCK);
     if (fd == -1)
@@ -833,19 +3201,57 @@ int main(int argc, char* argv[])
         goto cleanup;
     }
 
-    // 设置格式
+    // -n模式：流启动前等待一次格式/ROI协商连接
+    int nego_fd = -1;
+    if (negotiate_requested)
+    {
+        nego_fd = wait_format_request(NEGOTIATE_TIMEOUT_MS);
+    }
+
+    // 设置格式（含协商得到的分辨率与ROI）
     if (set_format_mp(fd, &fmt) < 0)
     {
+        if (nego_fd >= 0)
+        {
+            close(nego_fd);
+        }
         goto cleanup;
     }
 
+    // 回传实际生效的格式，完成协商
+    if (nego_fd >= 0)
+    {
+        send_format_reply(nego_fd);
+    }
+
     // 申请缓冲区
-    buffer_count = request_buffers_mp(fd, buffers, BUFFER_COUNT);
+    buffer_count = request_buffers_mp(fd, buffers, req_buffers);
     if (buffer_count < 0)
     {
         goto cleanup;
     }
 
+    // 锁定缓冲区物理内存，避免热路径缺页
+    lock_buffer_memory(buffers, buffer_count);
+
+    // 按需导出dmabuf并启动导出服务线程
+    if (dmabuf_sock_path)
+    {
+        if (export_dmabuf_fds(fd, buffers, buffer_count) < 0 ||
+            create_dmabuf_socket(dmabuf_sock_path) < 0)
+        {
+            goto cleanup;
+        }
+
+        if (pthread_create(&dmabuf_thread, NULL, dmabuf_exporter_thread, NULL)
+            != 0)
+        {
+            perror("Failed to create dmabuf exporter thread");
+            goto cleanup;
+        }
+        dmabuf_thread_started = 1;
+    }
+
     // 队列所有缓冲区
     for (int i = 0; i < buffer_count; i++)
     {
@@ -861,6 +3267,28 @@ int main(int argc, char* argv[])
         goto cleanup;
     }
 
+    // 分配压缩输出缓冲区池并启动压缩线程
+    if (compress_requested)
+    {
+        comp_buf_size = lz_compress_bound(fmt.fmt.pix_mp.plane_fmt[0].sizeimage);
+        for (int i = 0; i < COMP_POOL_COUNT; i++)
+        {
+            comp_pool[i] = malloc(comp_buf_size);
+            if (!comp_pool[i])
+            {
+                perror("Failed to allocate compression pool");
+                goto cleanup;
+            }
+        }
+
+        if (pthread_create(&comp_thread, NULL, compressor_thread, NULL) != 0)
+        {
+            perror("Failed to create compressor thread");
+            goto cleanup;
+        }
+        comp_thread_started = 1;
+    }
+
     // 启动USB发送线程
     if (pthread_create(&usb_thread, NULL, usb_sender_thread, NULL) != 0)
     {
@@ -868,11 +3296,26 @@ int main(int argc, char* argv[])
         goto cleanup;
     }
 
+    // 采集路径使用最高的实时优先级
+    setup_realtime_sched("Capture thread", rt_prio);
+
     // 主采集循环
     capture_loop(fd, buffers, buffer_count);
 
     // 等待线程结束
     pthread_join(usb_thread, NULL);
+    if (comp_thread_started)
+    {
+        pthread_join(comp_thread, NULL);
+    }
+    if (dmabuf_thread_started)
+    {
+        pthread_join(dmabuf_thread, NULL);
+    }
+    if (stats_thread_started)
+    {
+        pthread_join(stats_thread, NULL);
+    }
 
 cleanup:
     if (fd >= 0)
@@ -899,6 +3342,42 @@ cleanup:
         close(server_fd);
     }
 
+    if (lease_mgr.event_fd >= 0)
+    {
+        close(lease_mgr.event_fd);
+    }
+
+    if (frame_event_fd >= 0)
+    {
+        close(frame_event_fd);
+    }
+
+    if (comp_wake_fd >= 0)
+    {
+        close(comp_wake_fd);
+    }
+
+    if (stats_listen_fd >= 0)
+    {
+        close(stats_listen_fd);
+    }
+
+    for (int i = 0; i < COMP_POOL_COUNT; i++)
+    {
+        free(comp_pool[i]);
+    }
+
+    for (int i = 0; i < dmabuf_count; i++)
+    {
+        close(dmabuf_fds[i]);
+    }
+
+    if (dmabuf_listen_fd >= 0)
+    {
+        close(dmabuf_listen_fd);
+        unlink(dmabuf_sock_path);
+    }
+
     printf("Program terminated\n");
     return 0;
 }